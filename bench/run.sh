@@ -0,0 +1,70 @@
+#!/bin/sh
+# Benchmark suite: runs every guest image in this directory RUNS times
+# and reports host speed and cache behaviour.
+#
+# usage: bench/run.sh [runs]        (SIM overrides the simulator binary,
+#                                    SIMFLAGS adds simulator flags, e.g.
+#                                    SIMFLAGS="-U 256" for the MMU cost)
+#
+# workloads
+#   blkcopy  256-word block copy, mov (r0)+,(r1)+ / sob
+#   fill     512-word memory fill
+#   bsort    bubble sort of 64 words, reversed input
+#   sieve    sieve of Eratosthenes up to 4000
+#   cksum    LCG buffer fill and Fletcher checksum over 1024 words
+#   llist    walk of a 1024-node linked list with interleaved links
+#   matmul   8x8 matrix multiply with a shift-and-add multiply
+#   fsm      four-state machine over 1024 pseudo-random symbols
+#
+# output format (stable; one line per workload, columns never reordered,
+# new columns only ever appended; lines starting with # are comments)
+#   name      workload name
+#   runs      number of timed runs
+#   insts     guest instructions per run
+#   mips      mean host speed, millions of guest instructions per second
+#   mips_sd   sample standard deviation of mips
+#   ns_inst   mean host nanoseconds per guest instruction
+#   ns_sd     sample standard deviation of ns_inst
+#   hit_pct   cache hit rate in percent (deterministic), n/a with -C
+#   rss_kb    mean resident set of one simulator process in KiB
+
+SIM=${SIM:-./a.out}
+RUNS=${1:-5}
+DIR=$(dirname "$0")
+BENCHMARKS="blkcopy fill bsort sieve cksum llist matmul fsm"
+
+echo "# pdp11-sim bench format 1"
+echo "# runs=$RUNS flags=${SIMFLAGS:-none} date=$(date -u +%Y-%m-%dT%H:%M:%SZ) rev=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)"
+printf "%-8s %4s %10s %8s %8s %8s %8s %8s %8s\n" name runs insts mips mips_sd ns_inst ns_sd hit_pct rss_kb
+
+for b in $BENCHMARKS; do
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        "$SIM" -B $SIMFLAGS < "$DIR/$b.txt" | grep '^bench:'
+        i=$((i + 1))
+    done | awk -v name="$b" '
+        {
+            for (f = 2; f <= NF; f++) {
+                split($f, kv, "=")
+                val[kv[1]] = kv[2]
+            }
+            n++
+            insts = val["insts"]
+            mips[n] = insts * 1000 / val["host_ns"]
+            ns[n] = val["host_ns"] / insts
+            hits = val["cache_hits"]
+            misses = val["cache_misses"]
+            rss += val["rss_kb"]
+        }
+        END {
+            if (n == 0) { printf "%-8s failed\n", name; exit 1 }
+            for (r = 1; r <= n; r++) { ms += mips[r]; ns_s += ns[r] }
+            mm = ms / n; nm = ns_s / n
+            for (r = 1; r <= n; r++) { mv += (mips[r] - mm) ^ 2; nv += (ns[r] - nm) ^ 2 }
+            msd = n > 1 ? sqrt(mv / (n - 1)) : 0
+            nsd = n > 1 ? sqrt(nv / (n - 1)) : 0
+            hit = hits + misses > 0 ? sprintf("%.2f", 100 * hits / (hits + misses)) : "n/a"
+            printf "%-8s %4d %10d %8.2f %8.2f %8.2f %8.2f %8s %8d\n", name, n, insts,
+                   mm, msd, nm, nsd, hit, rss / n
+        }'
+done
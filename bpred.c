@@ -0,0 +1,181 @@
+/* branch predictor models
+ *
+ * every branch executed by br, bne, beq, and sob is fed to each
+ *   configured predictor, so several models can be compared in one
+ *   pass over the same branch stream
+ *
+ * routines
+ *
+ *   bool bpred_add( const char *spec );
+ *   void bpred_attach( void );
+ *   void bpred_branch( uint16_t pc, uint16_t target, bool taken );
+ *   void bpred_stats( int insts );
+ *
+ * predictor specs accepted by bpred_add() (sizes must be powers of 2)
+ *
+ *   static                   always predict not taken
+ *   btfn                     backward taken, forward not taken
+ *   bimodal:<entries>        2-bit counters indexed by PC
+ *   gshare:<entries>:<bits>  2-bit counters indexed by PC xor the
+ *                            last <bits> branch outcomes
+ *   btb:<entries>            direct-mapped branch target buffer;
+ *                            a hit predicts taken to the stored
+ *                            target, a miss predicts not taken
+ *
+ * a prediction is correct when both the direction and, for a predicted
+ *   taken branch, the target match; all branches here are PC-relative,
+ *   so only the BTB can get a target wrong
+ *
+ * 2-bit counter states: 0,1 = predict not taken; 2,3 = predict taken;
+ *   counters start weakly not taken (1)
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pdp11-sim.h"
+#include "bpred.h"
+#include "hooks.h"
+
+enum { STATIC, BTFN, BIMODAL, GSHARE, BTB };
+
+typedef struct {
+  int kind;
+  char name[32];
+  unsigned int
+    mask,       /* table entries - 1          */
+    hist_mask,  /* global history bits in use */
+    history;    /* global outcome history     */
+  uint8_t  *counter;  /* 2-bit counters (bimodal, gshare) */
+  uint8_t  *valid;    /* BTB valid bits   */
+  uint16_t *tag;      /* BTB branch PCs   */
+  uint16_t *dest;     /* BTB targets      */
+  uint64_t lookups, correct;
+} predictor_t;
+
+static predictor_t predictors[BPRED_MAX];
+static int num_predictors = 0;
+
+bool bpred_active = false;
+
+static bool power_of_2( long x ){
+  return x > 0 && (x & (x-1)) == 0;
+}
+
+bool bpred_add( const char *spec ){
+  predictor_t *p;
+  long size = 0, bits = 0;
+  char *end;
+
+  if( num_predictors == BPRED_MAX ) return false;
+  p = &predictors[num_predictors];
+  memset( p, 0, sizeof( *p ) );
+
+  if( strcmp( spec, "static" ) == 0 ){
+    p->kind = STATIC;
+  }else if( strcmp( spec, "btfn" ) == 0 ){
+    p->kind = BTFN;
+  }else if( strncmp( spec, "bimodal:", 8 ) == 0 ){
+    p->kind = BIMODAL;
+    size = strtol( spec+8, &end, 10 );
+    if( *end != '\0' ) return false;
+  }else if( strncmp( spec, "gshare:", 7 ) == 0 ){
+    p->kind = GSHARE;
+    size = strtol( spec+7, &end, 10 );
+    if( *end != ':' ) return false;
+    bits = strtol( end+1, &end, 10 );
+    if( *end != '\0' || bits < 1 || bits > 16 ) return false;
+  }else if( strncmp( spec, "btb:", 4 ) == 0 ){
+    p->kind = BTB;
+    size = strtol( spec+4, &end, 10 );
+    if( *end != '\0' ) return false;
+  }else{
+    return false;
+  }
+
+  if( p->kind == BIMODAL || p->kind == GSHARE ){
+    if( !power_of_2( size ) ) return false;
+    p->counter = malloc( size );
+    memset( p->counter, 1, size );
+  }else if( p->kind == BTB ){
+    if( !power_of_2( size ) ) return false;
+    p->valid = calloc( size, sizeof( p->valid[0] ) );
+    p->tag = calloc( size, sizeof( p->tag[0] ) );
+    p->dest = calloc( size, sizeof( p->dest[0] ) );
+  }
+  p->mask = size - 1;
+  p->hist_mask = (1u << bits) - 1;
+  snprintf( p->name, sizeof( p->name ), "%s", spec );
+
+  num_predictors++;
+  bpred_active = true;
+  return true;
+}
+
+static void train( uint8_t *counter, bool taken ){
+  if( taken && *counter < 3 ) (*counter)++;
+  if( !taken && *counter > 0 ) (*counter)--;
+}
+
+void bpred_branch( uint16_t pc, uint16_t target, bool taken ){
+  int i;
+  for( i=0; i<num_predictors; i++ ){
+    predictor_t *p = &predictors[i];
+    unsigned int index = 0;
+    bool predict = false, hit = false;
+
+    switch( p->kind ){
+      case STATIC:
+        predict = false;
+        break;
+      case BTFN:
+        predict = target <= pc;
+        break;
+      case BIMODAL:
+        index = (pc >> 1) & p->mask;
+        predict = p->counter[index] >= 2;
+        train( &p->counter[index], taken );
+        break;
+      case GSHARE:
+        index = ((pc >> 1) ^ p->history) & p->mask;
+        predict = p->counter[index] >= 2;
+        train( &p->counter[index], taken );
+        p->history = ((p->history << 1) | taken) & p->hist_mask;
+        break;
+      case BTB:
+        index = (pc >> 1) & p->mask;
+        hit = p->valid[index] && p->tag[index] == pc;
+        predict = hit;
+        if( hit && taken && p->dest[index] != target ) predict = !taken;
+        if( taken ){
+          p->valid[index] = 1;
+          p->tag[index] = pc;
+          p->dest[index] = target;
+        }
+        break;
+    }
+
+    p->lookups++;
+    if( predict == taken ) p->correct++;
+  }
+}
+
+/* register bpred_branch() on the branch hook */
+
+void bpred_attach( void ){
+  hook_branch( bpred_branch );
+}
+
+void bpred_stats( int insts ){
+  int i;
+  printf( "branch predictor statistics (in decimal):\n" );
+  printf( "  predictor                branches   mispredicts  accuracy     MPKI\n" );
+  for( i=0; i<num_predictors; i++ ){
+    predictor_t *p = &predictors[i];
+    uint64_t wrong = p->lookups - p->correct;
+    printf( "  %-22s %10llu %13llu  %6.2f%% %8.3f\n", p->name,
+            (unsigned long long)p->lookups, (unsigned long long)wrong,
+            p->lookups ? 100.0 * p->correct / p->lookups : 0.0,
+            insts ? 1000.0 * wrong / insts : 0.0 );
+  }
+}
@@ -0,0 +1,16 @@
+#ifndef BPRED_H
+#define BPRED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BPRED_MAX 8
+
+extern bool bpred_active;
+
+bool bpred_add( const char *spec );
+void bpred_attach( void );
+void bpred_branch( uint16_t pc, uint16_t target, bool taken );
+void bpred_stats( int insts );
+
+#endif
@@ -12,11 +12,17 @@
  * routines
  *
  *   void cache_init( void );
- *   void cache_access( unsigned int address, unsigned int type );
+ *   void cache_attach( void );
+ *   void cache_classify( void );
+ *   bool cache_policy( const char *spec );
+ *   void cache_access( uint16_t address, bool type );
+ *   bool cache_prefetch( uint16_t address, unsigned int latency );
  *   void cache_stats( void );
  *
  * for each call to cache_access() address is the byte address, and
- *   type is either read (=0) or write (=1)
+ *   type is either read (=0) or write (=1); cache_attach() registers
+ *   the cache on the fetch, read, and write hooks (hooks.c), which
+ *   call cache_access() for every reference the simulator makes
  *
  *
  * 4 KiB four-way set-associative cache, 32 bytes/line
@@ -69,9 +75,54 @@
  * 
  * NOTE: Cache size changed to 512 B
  * NOTE: Line size changed to 8 bytes
+ *
+ * write policies (cache_policy() with "<wb|wt>,<wa|nwa>")
+ *
+ *   write-back     a store marks the line dirty and memory is only
+ *                  written when the line is replaced (the default)
+ *   write-through  every store is also sent to memory; lines never
+ *                  become dirty, so there are no write-backs
+ *   write-allocate a store miss loads the line like a read miss (the
+ *                  default)
+ *   no-write-      a store miss leaves the cache untouched and only
+ *   allocate       writes memory
+ *
+ *   all writes to memory pass through the write buffer model in wbuf.c,
+ *   which also counts the memory write traffic in bytes; line fills
+ *   go to the DRAM model in dram.c when it is enabled
+ *
+ * three-C miss classification (after cache_classify())
+ *
+ *   compulsory  first access ever to the line, tracked in a bitmap
+ *               with one bit per line of the 64 KiB address space
+ *   capacity    a fully associative LRU cache of the same capacity
+ *               (CACHE_LINES lines) would have missed too
+ *   conflict    the fully associative shadow cache would have hit
+ *
+ * the shadow cache is a doubly-linked LRU list threaded through arrays
+ *   indexed by line number, so each access is O(1) with no search; it
+ *   sees every access, hits included, to keep its LRU order exact
+ *
+ * prefetch fills (cache_prefetch(), driven by prefetch.c)
+ *
+ *   a prefetch installs a clean line without counting as an access; the
+ *   line is tagged as prefetched and becomes ready latency accesses
+ *   later, so the first demand reference to it counts as
+ *
+ *   useful     the line had arrived
+ *   late       the line was still in flight
+ *
+ *   a prefetched line replaced before any demand reference counts as
+ *   unused, and a demand miss to a line that a prefetch evicted counts
+ *   as pollution
  */
 
+#include <string.h>
+
 #include "cache.h"
+#include "wbuf.h"
+#include "dram.h"
+#include "hooks.h"
 
 unsigned int
   plru_state[LINES_PER_BANK],  /* current state for each set */
@@ -103,7 +154,41 @@ unsigned int
     cache_writes, /* counter */
     hits,         /* counter */
     misses,       /* counter */
-    write_backs;  /* counter */
+    write_backs,  /* counter */
+    compulsory_misses,  /* counter */
+    capacity_misses,    /* counter */
+    conflict_misses;    /* counter */
+
+bool classify_misses = false;  /* three-C classification enabled */
+
+bool
+  write_through = false,   /* write policy, write-back when false     */
+  write_allocate = true,   /* allocate lines on store misses          */
+  policy_set = false;      /* report write traffic in cache_stats()   */
+
+uint8_t first_touch[ADDR_LINES/8];  /* first-touch bitmap, one bit per line */
+
+int32_t
+  shadow_prev[ADDR_LINES],  /* toward MRU, -1 at the head      */
+  shadow_next[ADDR_LINES],  /* toward LRU, -1 at the tail      */
+  shadow_head,              /* most recently used line, or -1  */
+  shadow_tail;              /* least recently used line, or -1 */
+unsigned int shadow_count;  /* lines in the shadow cache       */
+bool in_shadow[ADDR_LINES];
+
+bool prefetching = false;  /* a prefetcher has installed lines */
+
+unsigned int
+  prefetched[4][LINES_PER_BANK];  /* line was prefetched, not yet used */
+uint32_t
+  prefetch_ready[4][LINES_PER_BANK];  /* access count when it arrives */
+uint8_t prefetch_victim[ADDR_LINES/8];  /* lines evicted by a prefetch */
+
+unsigned int
+    prefetch_useful,    /* counter */
+    prefetch_late,      /* counter */
+    prefetch_unused,    /* counter */
+    prefetch_pollution; /* counter */
 
 void cache_init( void ){
   int i;
@@ -115,6 +200,82 @@ void cache_init( void ){
     valid[3][i] = dirty[3][i] = tag[3][i] = 0;
   }
   cache_reads = cache_writes = hits = misses = write_backs = 0;
+  compulsory_misses = capacity_misses = conflict_misses = 0;
+  prefetch_useful = prefetch_late = prefetch_unused = prefetch_pollution = 0;
+}
+
+/* device registers on the I/O page (160000 and up) are not cached */
+
+static void fetch_hook( uint16_t pc, uint16_t address ){
+  if( address < 0160000 ) cache_access( address, 0 );
+}
+
+static void read_hook( uint16_t pc, uint16_t address ){
+  if( address < 0160000 ) cache_access( address, 0 );
+}
+
+static void write_hook( uint16_t pc, uint16_t address ){
+  if( address < 0160000 ) cache_access( address, 1 );
+}
+
+void cache_attach( void ){
+  hook_fetch( fetch_hook );
+  hook_read( read_hook );
+  hook_write( write_hook );
+}
+
+void cache_classify( void ){
+  int i;
+  for( i=0; i<ADDR_LINES; i++ ) in_shadow[i] = false;
+  for( i=0; i<ADDR_LINES/8; i++ ) first_touch[i] = 0;
+  shadow_head = shadow_tail = -1;
+  shadow_count = 0;
+  compulsory_misses = capacity_misses = conflict_misses = 0;
+  classify_misses = true;
+}
+
+bool cache_policy( const char *spec ){
+  char hit[4], miss[4];
+  if( sscanf( spec, "%3[a-z],%3[a-z]", hit, miss ) != 2 ) return false;
+  if( strcmp( hit, "wt" ) == 0 ) write_through = true;
+  else if( strcmp( hit, "wb" ) == 0 ) write_through = false;
+  else return false;
+  if( strcmp( miss, "wa" ) == 0 ) write_allocate = true;
+  else if( strcmp( miss, "nwa" ) == 0 ) write_allocate = false;
+  else return false;
+  policy_set = true;
+  return true;
+}
+
+/* reference a line in the fully associative shadow cache, returns hit */
+
+static bool shadow_access( int32_t line ){
+  bool hit = in_shadow[line];
+
+  if( hit ){
+    if( line == shadow_head ) return true;
+    /* unlink */
+    shadow_next[shadow_prev[line]] = shadow_next[line];
+    if( shadow_next[line] != -1 ) shadow_prev[shadow_next[line]] = shadow_prev[line];
+    else shadow_tail = shadow_prev[line];
+  }else if( shadow_count == CACHE_LINES ){
+    /* evict the LRU line */
+    int32_t victim = shadow_tail;
+    in_shadow[victim] = false;
+    shadow_tail = shadow_prev[victim];
+    shadow_next[shadow_tail] = -1;
+  }else{
+    shadow_count++;
+  }
+
+  /* insert at the MRU end */
+  in_shadow[line] = true;
+  shadow_prev[line] = -1;
+  shadow_next[line] = shadow_head;
+  if( shadow_head != -1 ) shadow_prev[shadow_head] = line;
+  shadow_head = line;
+  if( shadow_tail == -1 ) shadow_tail = line;
+  return hit;
 }
 
 void cache_stats( void ){
@@ -124,32 +285,52 @@ void cache_stats( void ){
   printf( "  cache hits        = %d\n", hits );
   printf( "  cache misses      = %d\n", misses );
   printf( "  cache write backs = %d\n", write_backs );
+  if( classify_misses ){
+    printf( "  level 1 misses by cause:\n" );
+    printf( "    compulsory      = %d\n", compulsory_misses );
+    printf( "    capacity        = %d\n", capacity_misses );
+    printf( "    conflict        = %d\n", conflict_misses );
+  }
+  if( policy_set || wbuf_active ){
+    printf( "  write policy: %s, %s\n", write_through ? "write-through" : "write-back",
+            write_allocate ? "write-allocate" : "no-write-allocate" );
+    wbuf_stats();
+  }
 }
 
 
 /* address is byte address, type is read (=0) or write (=1) */
 
-void cache_access( uint8_t address, bool type ){
+void cache_access( uint16_t address, bool type ){
 
-  uint8_t
+  unsigned int
     addr_tag,    /* tag bits of address     */
     addr_index,  /* index bits of address   */
     bank;        /* bank that hit, or bank chosen for replacement */
 
+  bool
+    shadow_hit = false;  /* fully associative shadow cache hit */
+
+  unsigned int
+    word_mask = 3 << (address & 2);  /* bytes of the line a store writes */
+
+  wbuf_tick();
+
   if( type == 0 ){
     cache_reads++;
   }else{
     cache_writes++;
   }
 
-  // tag (1) | index (5) | offset (2)
+  if( classify_misses ) shadow_hit = shadow_access( address >> LINE_SHIFT );
+
+  // tag (9) | index (5) | offset (2)
 
   // Get index for 8 byte line size and mask with 5
   addr_index = (address >> 2) & 0x1F;
 
-  // Get tag for 8 byte line size
-  //addr_tag = (address >> 8) & 0x7F;
-  addr_tag = (address >> 7) & 0x7F; // <-- something is wrong here
+  // Get tag, all address bits above the index
+  addr_tag = address >> 7;
 
   /* check bank 0 hit */
 
@@ -180,6 +361,25 @@ void cache_access( uint8_t address, bool type ){
   }else{
     misses++;
 
+    if( classify_misses ){
+      unsigned int line = address >> LINE_SHIFT;
+      if( !(first_touch[line >> 3] & (1 << (line & 7))) ){
+        compulsory_misses++;
+        first_touch[line >> 3] |= 1 << (line & 7);
+      }else if( !shadow_hit ){
+        capacity_misses++;
+      }else{
+        conflict_misses++;
+      }
+    }
+
+    /* store miss without allocation only writes memory */
+
+    if( type == 1 && !write_allocate ){
+      wbuf_write( address >> LINE_SHIFT, word_mask );
+      return;
+    }
+
          if( !valid[0][addr_index] ) bank = 0;
     else if( !valid[1][addr_index] ) bank = 1;
     else if( !valid[2][addr_index] ) bank = 2;
@@ -188,6 +388,19 @@ void cache_access( uint8_t address, bool type ){
 
     if( valid[bank][addr_index] && dirty[bank][addr_index] ){
       write_backs++;
+      wbuf_write( (tag[bank][addr_index] << 5) | addr_index, 0xF );
+    }
+
+    if( dram_active ) dram_cycles += dram_access( address >> LINE_SHIFT, false );
+
+    if( prefetching ){
+      unsigned int line = address >> LINE_SHIFT;
+      if( prefetch_victim[line >> 3] & (1 << (line & 7)) ){
+        prefetch_pollution++;
+        prefetch_victim[line >> 3] &= ~(1 << (line & 7));
+      }
+      if( valid[bank][addr_index] && prefetched[bank][addr_index] ) prefetch_unused++;
+      prefetched[bank][addr_index] = 0;
     }
 
     valid[bank][addr_index] = 1;
@@ -195,12 +408,69 @@ void cache_access( uint8_t address, bool type ){
     tag[bank][addr_index] = addr_tag;
   }
 
+  /* first demand reference to a prefetched line */
+
+  if( prefetched[bank][addr_index] ){
+    if( prefetch_ready[bank][addr_index] > cache_reads + cache_writes ) prefetch_late++;
+    else prefetch_useful++;
+    prefetched[bank][addr_index] = 0;
+  }
+
   /* update replacement state for this set (i.e., index value) */
 
   plru_state[addr_index] = next_state[ (plru_state[addr_index]<<2) | bank ];
 
-  /* update dirty bit on a write */
+  /* update dirty bit on a write, or send it on to memory */
 
-  if( type == 1 ) dirty[bank][addr_index] = 1;
+  if( type == 1 ){
+    if( write_through ) wbuf_write( address >> LINE_SHIFT, word_mask );
+    else dirty[bank][addr_index] = 1;
+  }
 }
 
+/* install the line holding address ahead of demand, returns false if
+ *   it is already in the cache */
+
+bool cache_prefetch( uint16_t address, unsigned int latency ){
+
+  unsigned int
+    addr_tag = address >> 7,
+    addr_index = (address >> 2) & 0x1F,
+    bank,
+    victim;
+
+  prefetching = true;
+
+  for( bank=0; bank<4; bank++ ){
+    if( valid[bank][addr_index] && (addr_tag==tag[bank][addr_index]) ) return false;
+  }
+
+       if( !valid[0][addr_index] ) bank = 0;
+  else if( !valid[1][addr_index] ) bank = 1;
+  else if( !valid[2][addr_index] ) bank = 2;
+  else if( !valid[3][addr_index] ) bank = 3;
+  else bank = plru_bank[ plru_state[addr_index] ];
+
+  if( valid[bank][addr_index] ){
+    victim = (tag[bank][addr_index] << 5) | addr_index;
+    prefetch_victim[victim >> 3] |= 1 << (victim & 7);
+    if( prefetched[bank][addr_index] ) prefetch_unused++;
+    if( dirty[bank][addr_index] ){
+      write_backs++;
+      wbuf_write( victim, 0xF );
+    }
+  }
+
+  victim = address >> LINE_SHIFT;
+  prefetch_victim[victim >> 3] &= ~(1 << (victim & 7));
+  if( dram_active ) dram_prefetch( victim );
+
+  valid[bank][addr_index] = 1;
+  dirty[bank][addr_index] = 0;
+  tag[bank][addr_index] = addr_tag;
+  prefetched[bank][addr_index] = 1;
+  prefetch_ready[bank][addr_index] = cache_reads + cache_writes + latency;
+
+  plru_state[addr_index] = next_state[ (plru_state[addr_index]<<2) | bank ];
+  return true;
+}
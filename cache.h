@@ -6,10 +6,21 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-#define LINES_PER_BANK 16
+#define LINES_PER_BANK 32
+#define LINE_SHIFT 2                      /* 4-byte lines */
+#define CACHE_LINES (4*LINES_PER_BANK)    /* 4 banks */
+#define ADDR_LINES (65536 >> LINE_SHIFT)  /* lines in the address space */
+
+extern unsigned int cache_reads, cache_writes, hits, misses, write_backs;
+extern unsigned int compulsory_misses, capacity_misses, conflict_misses;
+extern unsigned int prefetch_useful, prefetch_late, prefetch_unused, prefetch_pollution;
 
 void cache_init( void );
+void cache_attach( void );
+void cache_classify( void );
+bool cache_policy( const char *spec );
 void cache_stats( void );
-void cache_access( uint8_t address, bool type );
+void cache_access( uint16_t address, bool type );
+bool cache_prefetch( uint16_t address, unsigned int latency );
 
 #endif
\ No newline at end of file
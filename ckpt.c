@@ -0,0 +1,290 @@
+/* checkpoints of the whole machine
+ *
+ * routines
+ *
+ *   void ckpt_region( void *base, size_t size );
+ *   bool ckpt_init( const char *spec );
+ *   void ckpt_take( void );
+ *   int ckpt_find( uint64_t count );
+ *   uint64_t ckpt_count( int i );
+ *   int ckpt_num( void );
+ *   void ckpt_load( int i );
+ *   void ckpt_stats( void );
+ *
+ * a checkpoint holds memory[] and every region given to ckpt_region():
+ *   registers, condition codes, the execution counters, the event queue
+ *   and interrupt requests, device registers and the MMU; restoring one
+ *   and executing forward gives the same run again, since nothing else
+ *   feeds the machine
+ *
+ * only the first checkpoint copies all of memory[]; later ones hold the
+ *   pages stored to since the one before, found in dirty_map, which
+ *   every store to memory[] keeps up to date; restoring copies back only
+ *   the pages that can differ, each from the latest checkpoint at or
+ *   before the target that holds it
+ *
+ * spec is the interval in instructions, CKPT_INTERVAL by default; the
+ *   caller takes a checkpoint whenever the instruction count reaches
+ *   ckpt_next, and counts that already have one are skipped when a
+ *   restored run passes them again; when CKPT_MAX are held every other
+ *   one is dropped, its pages going to the next, and the interval
+ *   doubles, so memory stays bounded however long the run
+ *
+ * the analysis models are not part of the machine and are not restored;
+ *   the debugger runs the restored stretch without them instead
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ckpt.h"
+#include "pdp11-sim.h"
+#include "events.h"
+
+#define PAGE_WORDS (1 << PAGE_SHIFT)  /* entries of memory[] per page */
+
+typedef struct {
+  void *base;
+  size_t size;
+} region_t;
+
+typedef struct {
+  uint64_t count;     /* instructions executed when taken */
+  uint8_t *state;     /* the regions, back to back */
+  uint32_t num_pages; /* pages of memory[] held */
+  uint32_t *pages;    /* their numbers, ascending */
+  uint16_t *data;     /* their contents, PAGE_WORDS entries each */
+} ckpt_t;
+
+static region_t regions[CKPT_REGIONS];
+static int num_regions = 0;
+static size_t state_size = 0;
+
+static ckpt_t ckpts[CKPT_MAX];
+static int num_ckpts = 0;
+static uint64_t interval = CKPT_INTERVAL;
+static int base = -1;  /* checkpoint memory[] differs from only in dirty_map */
+static uint8_t pageset[DIRTY_BYTES];
+
+uint64_t
+  ckpt_next = 0,       /* instruction count of the next checkpoint */
+  ckpts_taken = 0,     /* counter */
+  ckpts_loaded = 0,    /* counter */
+  pages_saved = 0,     /* counter */
+  pages_loaded = 0;    /* counter */
+bool ckpt_replaying = false;  /* executing again what was already run */
+
+void ckpt_region( void *base, size_t size ){
+  if( num_regions == CKPT_REGIONS ){
+    printf( "Too many checkpoint regions\n" );
+    exit( 1 );
+  }
+  regions[num_regions].base = base;
+  regions[num_regions].size = size;
+  num_regions++;
+  state_size += size;
+}
+
+bool ckpt_init( const char *spec ){
+  char *end;
+  long long n = strtoll( spec, &end, 10 );
+  if( *end != '\0' || n < 1 ) return false;
+  interval = n;
+  return true;
+}
+
+static uint32_t total_pages( void ){
+  return memory_words >> PAGE_SHIFT;
+}
+
+static bool in_set( uint8_t *set, uint32_t p ){
+  return set[p >> 3] & (1 << (p & 7));
+}
+
+static void add_pages( uint8_t *set, ckpt_t *k ){
+  uint32_t i;
+  for( i=0; i<k->num_pages; i++ ) set[k->pages[i] >> 3] |= 1 << (k->pages[i] & 7);
+}
+
+/* where checkpoint k holds page p, or NULL */
+static uint16_t *page_data( ckpt_t *k, uint32_t p ){
+  uint32_t lo = 0, hi = k->num_pages;
+  while( lo < hi ){
+    uint32_t mid = (lo + hi) / 2;
+    if( k->pages[mid] == p ) return k->data + (size_t)mid * PAGE_WORDS;
+    if( k->pages[mid] < p ) lo = mid + 1;
+    else hi = mid;
+  }
+  return NULL;
+}
+
+/* fill k's page list from set, copying each page from src(p) */
+static void store_pages( ckpt_t *k, uint8_t *set, uint16_t *(*src)( uint32_t p ) ){
+  uint32_t p, n = 0, total = total_pages();
+
+  for( p=0; p<total; p++ ) n += in_set( set, p );
+  k->num_pages = n;
+  k->pages = malloc( (n ? n : 1) * sizeof( k->pages[0] ) );
+  k->data = malloc( (n ? n : 1) * PAGE_WORDS * sizeof( k->data[0] ) );
+  if( k->pages == NULL || k->data == NULL ){
+    printf( "Out of memory for checkpoints\n" );
+    exit( 1 );
+  }
+  for( n=0, p=0; p<total; p++ ){
+    if( !in_set( set, p ) ) continue;
+    k->pages[n] = p;
+    memcpy( k->data + (size_t)n * PAGE_WORDS, src( p ), PAGE_WORDS * sizeof( k->data[0] ) );
+    n++;
+  }
+}
+
+static void free_pages( ckpt_t *k ){
+  free( k->state );
+  free( k->pages );
+  free( k->data );
+}
+
+static uint16_t *live_page( uint32_t p ){
+  return memory + ((size_t)p << PAGE_SHIFT);
+}
+
+/* for merging a dropped checkpoint into the one after it */
+static ckpt_t *merge_old, *merge_new;
+static uint16_t *merged_page( uint32_t p ){
+  uint16_t *d = page_data( merge_new, p );
+  return d ? d : page_data( merge_old, p );
+}
+
+/* drop every other checkpoint, keeping the first; a dropped one's pages
+ *   move into the next, which then holds every change since the last
+ *   one kept */
+static void thin( void ){
+  int i, j = 1;
+  ckpt_t merged;
+
+  for( i=1; i<num_ckpts; i++ ){
+    if( !(i & 1) ){
+      ckpts[j++] = ckpts[i];
+      continue;
+    }
+    if( i == base ){
+      add_pages( dirty_map, &ckpts[i] );
+      base--;
+    }
+    if( i + 1 < num_ckpts ){
+      memset( pageset, 0, sizeof( pageset ) );
+      add_pages( pageset, &ckpts[i] );
+      add_pages( pageset, &ckpts[i+1] );
+      merge_old = &ckpts[i];
+      merge_new = &ckpts[i+1];
+      merged = ckpts[i+1];
+      store_pages( &merged, pageset, merged_page );
+      free( ckpts[i+1].pages );
+      free( ckpts[i+1].data );
+      ckpts[i+1] = merged;
+    }
+    free_pages( &ckpts[i] );
+  }
+  base /= 2;
+  num_ckpts = j;
+  interval *= 2;
+}
+
+void ckpt_take( void ){
+  uint64_t now = sched_now();
+  ckpt_t *k;
+  uint8_t *p;
+  int i;
+
+  if( num_ckpts && ckpts[num_ckpts-1].count >= now ) return;
+  if( num_ckpts == CKPT_MAX ) thin();
+
+  /* the pages memory[] may differ in from the last checkpoint: those
+   *   stored to since the base, and those the base differs in */
+  if( num_ckpts == 0 ){
+    memset( pageset, 0xFF, sizeof( pageset ) );
+  }else{
+    memcpy( pageset, dirty_map, sizeof( pageset ) );
+    for( i=base+1; i<num_ckpts; i++ ) add_pages( pageset, &ckpts[i] );
+  }
+
+  k = &ckpts[num_ckpts];
+  k->count = now;
+  k->state = malloc( state_size );
+  if( k->state == NULL ){
+    printf( "Out of memory for checkpoints\n" );
+    exit( 1 );
+  }
+  for( p=k->state, i=0; i<num_regions; p+=regions[i].size, i++ ){
+    memcpy( p, regions[i].base, regions[i].size );
+  }
+  store_pages( k, pageset, live_page );
+  pages_saved += k->num_pages;
+
+  memset( dirty_map, 0, sizeof( dirty_map ) );
+  base = num_ckpts++;
+  ckpts_taken++;
+  ckpt_next = now + interval;
+}
+
+/* latest checkpoint at or before count, or -1 */
+int ckpt_find( uint64_t count ){
+  int i;
+  for( i=num_ckpts-1; i>=0; i-- ){
+    if( ckpts[i].count <= count ) return i;
+  }
+  return -1;
+}
+
+uint64_t ckpt_count( int i ){
+  return ckpts[i].count;
+}
+
+int ckpt_num( void ){
+  return num_ckpts;
+}
+
+void ckpt_load( int i ){
+  uint32_t pg, total = total_pages();
+  uint16_t *d;
+  uint8_t *p;
+  int j, lo, hi;
+
+  for( p=ckpts[i].state, j=0; j<num_regions; p+=regions[j].size, j++ ){
+    memcpy( regions[j].base, p, regions[j].size );
+  }
+
+  /* only the pages memory[] can differ in from checkpoint i, each from
+   *   the latest checkpoint up to i that holds it */
+  memcpy( pageset, dirty_map, sizeof( pageset ) );
+  lo = i < base ? i : base;
+  hi = i < base ? base : i;
+  for( j=lo+1; j<=hi; j++ ) add_pages( pageset, &ckpts[j] );
+  for( pg=0; pg<total; pg++ ){
+    if( !in_set( pageset, pg ) ) continue;
+    for( j=i; (d = page_data( &ckpts[j], pg )) == NULL; j-- );
+    memcpy( live_page( pg ), d, PAGE_WORDS * sizeof( d[0] ) );
+    pages_loaded++;
+  }
+
+  memset( dirty_map, 0, sizeof( dirty_map ) );
+  base = i;
+  ckpts_loaded++;
+}
+
+void ckpt_stats( void ){
+  uint64_t held = 0;
+  int i;
+  for( i=0; i<num_ckpts; i++ ) held += ckpts[i].num_pages;
+
+  printf( "checkpoint statistics (in decimal):\n" );
+  printf( "  checkpoints taken = %llu\n", (unsigned long long)ckpts_taken );
+  printf( "  checkpoints held  = %d\n", num_ckpts );
+  printf( "  restores          = %llu\n", (unsigned long long)ckpts_loaded );
+  printf( "  interval          = %llu\n", (unsigned long long)interval );
+  printf( "  pages saved       = %llu\n", (unsigned long long)pages_saved );
+  printf( "  pages held        = %llu (%llu bytes)\n", (unsigned long long)held,
+          (unsigned long long)(held * PAGE_WORDS * sizeof( memory[0] )) );
+  printf( "  pages restored    = %llu\n", (unsigned long long)pages_loaded );
+}
@@ -0,0 +1,24 @@
+#ifndef CKPT_H
+#define CKPT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define CKPT_MAX 32        /* checkpoints kept before thinning */
+#define CKPT_REGIONS 64    /* state regions outside memory[] */
+#define CKPT_INTERVAL 100000  /* default instructions between checkpoints */
+
+extern uint64_t ckpt_next;
+extern bool ckpt_replaying;
+
+void ckpt_region( void *base, size_t size );
+bool ckpt_init( const char *spec );
+void ckpt_take( void );
+int ckpt_find( uint64_t count );
+uint64_t ckpt_count( int i );
+int ckpt_num( void );
+void ckpt_load( int i );
+void ckpt_stats( void );
+
+#endif
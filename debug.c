@@ -0,0 +1,172 @@
+/* debugger with reverse execution
+ *
+ * routines
+ *
+ *   bool debug_open( const char *path );
+ *   void debug_run( void (*step)( void ), void (*replay)( void ) );
+ *
+ * debug_run() reads commands from the file given to debug_open() ("-"
+ *   for stdin), one per line, numbers in octal except counts:
+ *
+ *     s [n]          step n instructions, default 1
+ *     c              continue to a breakpoint or halt
+ *     rs [n]         reverse step n instructions, default 1
+ *     rc             reverse continue to the last breakpoint hit before
+ *                    the current instruction
+ *     g <n>          go to instruction count n, forward or back
+ *     b <addr>       set a breakpoint
+ *     d <addr>       delete a breakpoint
+ *     r              show the registers
+ *     x <addr> [n]   examine n words, default 1, as the program would
+ *                    read them but without side effects
+ *     q              leave the debugger and run on without it
+ *
+ *   and stops at the end of the file the same way as q; after every
+ *   command the instruction count, PC and next instruction are shown
+ *
+ * going back restores the latest checkpoint at or before the target
+ *   count and executes forward to it (see ckpt.c) with replay, the
+ *   core without access hooks, up to the furthest count reached so far,
+ *   and with step beyond it; the machine steps one instruction at a
+ *   time here, serving events and taking checkpoints at the same counts
+ *   as the run loops
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "pdp11-sim.h"
+#include "events.h"
+#include "ckpt.h"
+#include "unibus.h"
+
+#define NO_HIT UINT64_MAX
+
+static FILE *script;
+static void (*step_fn)( void ), (*replay_fn)( void );
+static uint16_t breaks[DEBUG_BREAKS];
+static int num_breaks = 0;
+static uint64_t frontier = 0;  /* furthest instruction count reached */
+
+bool debug_open( const char *path ){
+  script = strcmp( path, "-" ) == 0 ? stdin : fopen( path, "r" );
+  return script != NULL;
+}
+
+static bool is_break( uint16_t pc ){
+  int i;
+  for( i=0; i<num_breaks; i++ ){
+    if( breaks[i] == pc ) return true;
+  }
+  return false;
+}
+
+/* one instruction, then whatever the run loops do after it; what is
+ *   run again goes without the access hooks, so the models count each
+ *   instruction once and are left as they were at the frontier */
+static void forward( void ){
+  (ckpt_replaying ? replay_fn : step_fn)();
+  if( sched_now() >= next_event ) sched_service();
+  if( sched_now() >= ckpt_next ) ckpt_take();
+  if( sched_now() >= frontier ){
+    frontier = sched_now();
+    ckpt_replaying = false;
+  }
+}
+
+static void load( int i ){
+  ckpt_load( i );
+  ckpt_replaying = sched_now() < frontier;
+}
+
+static void go_to( uint64_t target ){
+  if( target < sched_now() ) load( ckpt_find( target ) );
+  while( running && sched_now() < target ) forward();
+}
+
+/* last count before now with the PC on a breakpoint, searching back
+ *   one checkpoint interval at a time */
+static uint64_t last_hit( void ){
+  uint64_t now = sched_now(), end, hit = NO_HIT;
+  int i;
+
+  for( i=ckpt_find( now - 1 ); i>=0 && hit == NO_HIT; i-- ){
+    end = i + 1 < ckpt_num() && ckpt_count( i + 1 ) < now ? ckpt_count( i + 1 ) : now;
+    load( i );
+    while( sched_now() < end ){
+      if( is_break( reg[7] ) ) hit = sched_now();
+      forward();
+    }
+  }
+  return hit;
+}
+
+static void show( void ){
+  char buf[64];
+  disasm( reg[7], buf, sizeof( buf ) );
+  printf( "[%llu] %06o  %s%s\n", (unsigned long long)sched_now(), reg[7], buf,
+          running ? "" : "  (halted)" );
+}
+
+void debug_run( void (*step)( void ), void (*replay)( void ) ){
+  char line[128], cmd[8];
+  unsigned long long a1, a2;
+  uint64_t hit;
+  int args, i;
+
+  step_fn = step;
+  replay_fn = replay;
+  ckpt_take();
+  show();
+
+  while( fgets( line, sizeof( line ), script ) != NULL ){
+    args = sscanf( line, "%7s %llo %llo", cmd, &a1, &a2 );
+    if( args < 1 ) continue;
+
+    if( strcmp( cmd, "s" ) == 0 || strcmp( cmd, "rs" ) == 0 || strcmp( cmd, "g" ) == 0 ){
+      /* counts are decimal */
+      args = sscanf( line, "%7s %llu", cmd, &a1 );
+      if( args < 2 ) a1 = 1;
+      if( cmd[0] == 's' ) go_to( sched_now() + a1 );
+      else if( cmd[0] == 'g' ) go_to( a1 );
+      else go_to( a1 < sched_now() ? sched_now() - a1 : 0 );
+    }else if( strcmp( cmd, "c" ) == 0 ){
+      do forward(); while( running && !is_break( reg[7] ) );
+    }else if( strcmp( cmd, "rc" ) == 0 ){
+      if( (hit = last_hit()) == NO_HIT ){
+        printf( "no earlier breakpoint\n" );
+        go_to( 0 );
+      }else{
+        go_to( hit );
+      }
+    }else if( strcmp( cmd, "b" ) == 0 && args == 2 ){
+      if( num_breaks < DEBUG_BREAKS && !is_break( a1 ) ) breaks[num_breaks++] = a1;
+    }else if( strcmp( cmd, "d" ) == 0 && args == 2 ){
+      for( i=0; i<num_breaks; i++ ){
+        if( breaks[i] == a1 ) breaks[i--] = breaks[--num_breaks];
+      }
+    }else if( strcmp( cmd, "r" ) == 0 ){
+      printf( "  nzvc = %d%d%d%d  psw = %06o\n", n, z, v, c, psw_get() );
+      pregs();
+    }else if( strcmp( cmd, "x" ) == 0 && args >= 2 ){
+      if( args < 3 ) a2 = 1;
+      for( i=0; i<(int)a2; i++ ){
+        uint16_t addr = a1 + 2*i, word;
+        if( bus_peek( addr, &word ) ) printf( "  %06o: %06o\n", addr, word );
+        else printf( "  %06o: nonexistent\n", addr );
+      }
+    }else if( strcmp( cmd, "q" ) == 0 ){
+      break;
+    }else{
+      printf( "Invalid debugger command: %s", line );
+      continue;
+    }
+    show();
+  }
+
+  /* catch up with the furthest point reached, so that running on from
+   *   here prints nothing twice */
+  go_to( frontier );
+}
@@ -0,0 +1,11 @@
+#ifndef DEBUG_H
+#define DEBUG_H
+
+#include <stdbool.h>
+
+#define DEBUG_BREAKS 16  /* breakpoints at once */
+
+bool debug_open( const char *path );
+void debug_run( void (*step)( void ), void (*replay)( void ) );
+
+#endif
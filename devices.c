@@ -0,0 +1,213 @@
+/* line clock and console terminal
+ *
+ * routines
+ *
+ *   void devices_init( void );
+ *   bool clock_start( const char *spec );
+ *   bool console_input( const char *path );
+ *   void console_drain( void );
+ *   void devices_ckpt( void );
+ *
+ * devices_init() puts both devices' registers on the I/O page; the
+ *   clock only ticks after clock_start(), and the console only
+ *   receives after console_input()
+ *
+ * KW11-L line clock, LKS at 177546
+ *
+ *   bit 7 is set on every tick and cleared by writing 0 to it, bit 6
+ *   enables an interrupt at priority 6 through vector 100 on every
+ *   tick; spec is the tick period in instructions
+ *
+ * DL11 console, RCSR 177560, RBUF 177562, XCSR 177564, XBUF 177566
+ *
+ *   a character written to XBUF clears XCSR ready (bit 7) and is
+ *   printed on stdout CONSOLE_DELAY instructions later, when ready is
+ *   set again; the receiver polls the input given to console_input()
+ *   CONSOLE_DELAY instructions after RBUF was last read, and again
+ *   every CONSOLE_DELAY while a terminal or pipe has nothing; each
+ *   character sets RCSR done (bit 7) until RBUF is read; bit 6 of
+ *   either CSR enables an interrupt at priority 4 through vector 64
+ *   (ready) or 60 (done); with a journal (journal.c) the polls are
+ *   recorded or answered from it, and path may be NULL when replaying
+ *
+ * the line finishes a character in progress by itself, so
+ *   console_drain(), called on HALT, prints one still in XBUF at once
+ *   and sets ready without an interrupt
+ *
+ * an input file is read at a recorded offset, so a restored checkpoint
+ *   receives the same characters again; characters sent while
+ *   ckpt_replaying is set were printed the first time and are not
+ *   printed again
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "devices.h"
+#include "events.h"
+#include "unibus.h"
+#include "ckpt.h"
+#include "journal.h"
+
+static uint16_t
+  lks = 0,            /* clock status */
+  rcsr = 0,           /* receiver status */
+  rbuf = 0,           /* received character */
+  xcsr = 0200,        /* transmitter status, ready */
+  xbuf = 0;           /* character being sent */
+
+static uint64_t clock_period;
+static FILE *input = NULL;
+static bool
+  receiving = false,       /* the receiver has an input */
+  input_seekable = false;  /* input is a file, not a terminal or pipe */
+static long input_offset = 0;  /* characters received from a file so far */
+
+uint64_t clock_ticks = 0;  /* counter */
+
+/* line clock */
+
+static void clock_tick( void ){
+  clock_ticks++;
+  lks |= 0200;
+  if( lks & 0100 ) irq_raise( CLOCK_VECTOR, 6 );
+  sched_at( sched_now() + clock_period, clock_tick );
+}
+
+static uint16_t clock_read( uint16_t address ){
+  return lks;
+}
+
+static void clock_write( uint16_t address, uint16_t value ){
+  lks = (value & 0100) | (lks & value & 0200);
+  if( !(lks & 0100) ) irq_clear( CLOCK_VECTOR );
+}
+
+bool clock_start( const char *spec ){
+  char *end;
+  long period = strtol( spec, &end, 10 );
+  if( *end != '\0' || period < 1 ) return false;
+  clock_period = period;
+  sched_at( sched_now() + clock_period, clock_tick );
+  return true;
+}
+
+/* console */
+
+/* the next input byte: a file is read at input_offset, a terminal or
+ *   pipe only when a byte is waiting */
+static int live_input( void ){
+  struct pollfd p;
+  unsigned char b;
+  int ch;
+
+  if( input == NULL ) return EOF;
+  if( input_seekable ){
+    fseek( input, input_offset, SEEK_SET );
+    if( (ch = fgetc( input )) != EOF ) input_offset++;
+    return ch;
+  }
+  p.fd = fileno( input );
+  p.events = POLLIN;
+  if( poll( &p, 1, 0 ) < 1 ) return INPUT_NONE;
+  return read( p.fd, &b, 1 ) == 1 ? b : EOF;
+}
+
+static void receive( void ){
+  int ch = journal_active ? journal_input( live_input ) : live_input();
+  if( ch == INPUT_NONE ){
+    sched_at( sched_now() + CONSOLE_DELAY, receive );
+    return;
+  }
+  if( ch == EOF ) return;
+  rbuf = ch & 0377;
+  rcsr |= 0200;
+  if( rcsr & 0100 ) irq_raise( CONSOLE_RX_VECTOR, 4 );
+}
+
+static void transmit_done( void ){
+  if( !ckpt_replaying ){
+    putchar( xbuf & 0177 );
+    fflush( stdout );
+  }
+  xcsr |= 0200;
+  if( xcsr & 0100 ) irq_raise( CONSOLE_TX_VECTOR, 4 );
+}
+
+static uint16_t console_read( uint16_t address ){
+  switch( address ){
+    case 0177560: return rcsr;
+    case 0177562:
+      if( (rcsr & 0200) && !bus_peeking ){
+        rcsr &= ~0200;
+        irq_clear( CONSOLE_RX_VECTOR );
+        if( receiving ) sched_at( sched_now() + CONSOLE_DELAY, receive );
+      }
+      return rbuf;
+    case 0177564: return xcsr;
+    default: return 0;
+  }
+}
+
+static void console_write( uint16_t address, uint16_t value ){
+  switch( address ){
+    case 0177560:
+      rcsr = (rcsr & ~0100) | (value & 0100);
+      if( (rcsr & 0300) == 0300 ) irq_raise( CONSOLE_RX_VECTOR, 4 );
+      else irq_clear( CONSOLE_RX_VECTOR );
+      break;
+    case 0177564:
+      xcsr = (xcsr & ~0100) | (value & 0100);
+      if( (xcsr & 0300) == 0300 ) irq_raise( CONSOLE_TX_VECTOR, 4 );
+      else irq_clear( CONSOLE_TX_VECTOR );
+      break;
+    case 0177566:
+      if( !(xcsr & 0200) ) break;  /* busy, character is lost */
+      xbuf = value;
+      xcsr &= ~0200;
+      irq_clear( CONSOLE_TX_VECTOR );
+      sched_at( sched_now() + CONSOLE_DELAY, transmit_done );
+      break;
+  }
+}
+
+void console_drain( void ){
+  if( xcsr & 0200 ) return;
+  sched_cancel( transmit_done );
+  if( !ckpt_replaying ){
+    putchar( xbuf & 0177 );
+    fflush( stdout );
+  }
+  xcsr |= 0200;
+}
+
+bool console_input( const char *path ){
+  struct stat st;
+
+  if( path != NULL ){
+    input = fopen( path, "rb" );
+    if( input == NULL || fstat( fileno( input ), &st ) != 0 ) return false;
+    input_seekable = S_ISREG( st.st_mode );
+  }
+  receiving = true;
+  sched_at( sched_now() + CONSOLE_DELAY, receive );
+  return true;
+}
+
+void devices_ckpt( void ){
+  ckpt_region( &lks, sizeof( lks ) );
+  ckpt_region( &rcsr, sizeof( rcsr ) );
+  ckpt_region( &rbuf, sizeof( rbuf ) );
+  ckpt_region( &xcsr, sizeof( xcsr ) );
+  ckpt_region( &xbuf, sizeof( xbuf ) );
+  ckpt_region( &input_offset, sizeof( input_offset ) );
+  ckpt_region( &clock_ticks, sizeof( clock_ticks ) );
+}
+
+void devices_init( void ){
+  unibus_register( 0177546, 1, clock_read, clock_write );
+  unibus_register( 0177560, 4, console_read, console_write );
+}
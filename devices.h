@@ -0,0 +1,20 @@
+#ifndef DEVICES_H
+#define DEVICES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CLOCK_VECTOR 0100
+#define CONSOLE_RX_VECTOR 060
+#define CONSOLE_TX_VECTOR 064
+#define CONSOLE_DELAY 100  /* instructions per character */
+
+extern uint64_t clock_ticks;
+
+void devices_init( void );
+bool clock_start( const char *spec );
+bool console_input( const char *path );
+void console_drain( void );
+void devices_ckpt( void );
+
+#endif
@@ -0,0 +1,139 @@
+/* DRAM timing model behind the cache
+ *
+ * every line the cache reads from memory (miss fills and prefetches)
+ *   and every write that leaves the write buffer is sent to a banked
+ *   DRAM with one row buffer per bank
+ *
+ * routines
+ *
+ *   bool dram_init( const char *spec );
+ *   unsigned int dram_access( uint32_t line, bool write );
+ *   void dram_prefetch( uint32_t line );
+ *   void dram_stats( void );
+ *
+ * spec is "<banks>,<open|closed>,<tRCD>,<tCAS>,<tRP>" with banks a
+ *   power of 2 (at most DRAM_BANKS_MAX) and the timings in processor
+ *   cycles; dram_access() returns the latency of one access;
+ *   dram_prefetch() is a read nothing waits for, counted apart so the
+ *   average miss latency covers demand reads only
+ *
+ *   open    the row stays open after an access: a row hit costs tCAS,
+ *           an idle bank tRCD + tCAS, and a different open row
+ *           tRP + tRCD + tCAS
+ *   closed  every access precharges afterwards, off the critical
+ *           path, so each access costs tRCD + tCAS
+ *
+ * addresses map as row | bank | column, with DRAM_ROW_SHIFT column
+ *   bits, so consecutive rows fall in consecutive banks
+ *
+ * callers that wait for the access (cache misses, and writes when
+ *   there is no write buffer) add the latency to dram_cycles, which
+ *   the timing model charges in place of its fixed miss and
+ *   write-back latencies; bank busy time and overlap between accesses
+ *   are not modeled
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+#include "dram.h"
+
+static unsigned int
+  banks,
+  t_rcd,
+  t_cas,
+  t_rp;
+
+static bool open_page;
+
+static int32_t open_row[DRAM_BANKS_MAX];  /* -1 when precharged */
+
+static uint64_t
+  reads = 0,          /* counter */
+  prefetches = 0,     /* counter */
+  writes = 0,         /* counter */
+  row_hits = 0,       /* counter */
+  row_empty = 0,      /* counter */
+  row_conflicts = 0,  /* counter */
+  read_latency = 0;   /* total cycles over demand reads */
+
+bool dram_active = false;
+uint64_t dram_cycles = 0;
+
+bool dram_init( const char *spec ){
+  char policy[8];
+  int b, rcd, cas, rp, i;
+  if( sscanf( spec, "%d,%7[a-z],%d,%d,%d", &b, policy, &rcd, &cas, &rp ) != 5 ) return false;
+  if( b < 1 || b > DRAM_BANKS_MAX || (b & (b-1)) != 0 ) return false;
+  if( rcd < 0 || cas < 0 || rp < 0 ) return false;
+  if( strcmp( policy, "open" ) == 0 ) open_page = true;
+  else if( strcmp( policy, "closed" ) == 0 ) open_page = false;
+  else return false;
+  banks = b;
+  t_rcd = rcd;
+  t_cas = cas;
+  t_rp = rp;
+  for( i=0; i<DRAM_BANKS_MAX; i++ ) open_row[i] = -1;
+  dram_active = true;
+  return true;
+}
+
+/* open or precharge the row; the latency of the access */
+
+static unsigned int row_access( uint32_t line ){
+  uint32_t
+    address = line << LINE_SHIFT,
+    bank = (address >> DRAM_ROW_SHIFT) & (banks - 1);
+  int32_t
+    row = (address >> DRAM_ROW_SHIFT) / banks;
+  unsigned int latency;
+
+  if( !open_page ){
+    row_empty++;
+    latency = t_rcd + t_cas;
+  }else if( open_row[bank] == row ){
+    row_hits++;
+    latency = t_cas;
+  }else if( open_row[bank] < 0 ){
+    row_empty++;
+    latency = t_rcd + t_cas;
+  }else{
+    row_conflicts++;
+    latency = t_rp + t_rcd + t_cas;
+  }
+  if( open_page ) open_row[bank] = row;
+  return latency;
+}
+
+unsigned int dram_access( uint32_t line, bool write ){
+  unsigned int latency = row_access( line );
+  if( write ){
+    writes++;
+  }else{
+    reads++;
+    read_latency += latency;
+  }
+  return latency;
+}
+
+void dram_prefetch( uint32_t line ){
+  row_access( line );
+  prefetches++;
+}
+
+void dram_stats( void ){
+  uint64_t total = reads + prefetches + writes;
+  printf( "dram statistics (in decimal):\n" );
+  printf( "  %u banks, %s page, tRCD=%u tCAS=%u tRP=%u\n",
+          banks, open_page ? "open" : "closed", t_rcd, t_cas, t_rp );
+  printf( "  reads             = %llu\n", (unsigned long long)reads );
+  printf( "  prefetch reads    = %llu\n", (unsigned long long)prefetches );
+  printf( "  writes            = %llu\n", (unsigned long long)writes );
+  printf( "  row hits          = %llu\n", (unsigned long long)row_hits );
+  printf( "  row empty         = %llu\n", (unsigned long long)row_empty );
+  printf( "  row conflicts     = %llu\n", (unsigned long long)row_conflicts );
+  if( total ) printf( "  row hit rate      = %.2f%%\n", 100.0 * row_hits / total );
+  if( reads ) printf( "  avg miss latency  = %.2f cycles\n", (double)read_latency / reads );
+  printf( "  stall cycles      = %llu\n", (unsigned long long)dram_cycles );
+}
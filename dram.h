@@ -0,0 +1,18 @@
+#ifndef DRAM_H
+#define DRAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DRAM_BANKS_MAX 64
+#define DRAM_ROW_SHIFT 9  /* 512-byte rows */
+
+extern bool dram_active;
+extern uint64_t dram_cycles;
+
+bool dram_init( const char *spec );
+unsigned int dram_access( uint32_t line, bool write );
+void dram_prefetch( uint32_t line );
+void dram_stats( void );
+
+#endif
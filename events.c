@@ -0,0 +1,239 @@
+/* event scheduler and interrupt requests
+ *
+ * devices schedule work for a future instruction count instead of
+ *   being polled; the main loop compares the instruction count with
+ *   next_event after every instruction and calls sched_service() only
+ *   when it is reached
+ *
+ * routines
+ *
+ *   void sched_at( uint64_t when, event_fn_t fn );
+ *   void sched_cancel( event_fn_t fn );
+ *   uint64_t sched_first( void );
+ *   void sched_service( void );
+ *   void irq_raise( uint16_t vector, int priority );
+ *   void irq_clear( uint16_t vector );
+ *   void irq_check( void );
+ *   void events_ckpt( void );
+ *   void sched_stats( void );
+ *
+ * events are kept in a binary min-heap on (when, sequence), so events
+ *   due at the same count fire in the order they were scheduled;
+ *   sched_first() is the count of the earliest one, or SCHED_NEVER
+ *
+ * an interrupt request stays pending until the device clears it or it
+ *   is taken; the highest priority pending request is taken at the next
+ *   instruction boundary once its priority is above the processor
+ *   priority (PSW bits 7-5): the new PC and PSW are loaded from the
+ *   vector in kernel space, the new PSW's previous mode (bits 13-12) is
+ *   the mode interrupted, and the old PSW and PC are pushed on the stack
+ *   through the new mode's mapping; there is one R6 for all modes, not
+ *   separate kernel and user stack pointers; irq_raise() and
+ *   irq_check() (after a PSW change) pull next_event in to the current
+ *   count when a request can be taken, so delivery costs nothing extra
+ *   in the main loop
+ *
+ * a WAIT instruction re-executes until an interrupt is taken, then the
+ *   interrupt returns past it
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "events.h"
+#include "unibus.h"
+#include "ckpt.h"
+#include "hooks.h"
+
+typedef struct {
+  uint64_t when;
+  uint64_t seq;
+  event_fn_t fn;
+} event_t;
+
+typedef struct {
+  uint16_t vector;
+  int priority;
+} irq_t;
+
+static event_t heap[SCHED_MAX];
+static int count = 0;
+static uint64_t seq = 0;
+
+static irq_t irqs[IRQ_MAX];
+static int pending = 0;
+
+uint64_t
+  next_event = SCHED_NEVER,  /* instruction count to call sched_service() at */
+  events_fired = 0,          /* counter */
+  interrupts_taken = 0,      /* counter */
+  sched_changes = 0;         /* bumped whenever the events or requests change */
+
+static bool earlier( event_t *a, event_t *b ){
+  return a->when < b->when || (a->when == b->when && a->seq < b->seq);
+}
+
+static void sift_up( int i ){
+  event_t e = heap[i];
+  while( i > 0 && earlier( &e, &heap[(i-1)/2] ) ){
+    heap[i] = heap[(i-1)/2];
+    i = (i-1)/2;
+  }
+  heap[i] = e;
+}
+
+static void sift_down( int i ){
+  event_t e = heap[i];
+  int child;
+  while( (child = 2*i + 1) < count ){
+    if( child + 1 < count && earlier( &heap[child+1], &heap[child] ) ) child++;
+    if( !earlier( &heap[child], &e ) ) break;
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = e;
+}
+
+/* highest priority request above the processor priority, or -1 */
+static int deliverable( void ){
+  int i, best = -1, level = (psw_high >> 5) & 7;
+  for( i=0; i<pending; i++ ){
+    if( irqs[i].priority > level && (best < 0 || irqs[i].priority > irqs[best].priority) ) best = i;
+  }
+  return best;
+}
+
+static void update_next( void ){
+  next_event = count ? heap[0].when : SCHED_NEVER;
+  if( deliverable() >= 0 ) next_event = sched_now();
+}
+
+void sched_at( uint64_t when, event_fn_t fn ){
+  if( count == SCHED_MAX ){
+    printf( "Too many scheduled events\n" );
+    exit( 1 );
+  }
+  heap[count].when = when;
+  heap[count].seq = seq++;
+  heap[count].fn = fn;
+  sift_up( count++ );
+  sched_changes++;
+  if( when < next_event ) next_event = when;
+}
+
+void sched_cancel( event_fn_t fn ){
+  int i;
+  for( i=0; i<count; i++ ){
+    if( heap[i].fn == fn ){
+      heap[i] = heap[--count];
+      if( i < count ){
+        sift_down( i );
+        sift_up( i );
+      }
+      i = -1;
+      sched_changes++;
+    }
+  }
+  update_next();
+}
+
+uint64_t sched_first( void ){
+  return count ? heap[0].when : SCHED_NEVER;
+}
+
+/* re-executed instructions stay out of the models, as in the core */
+static bool hook_refs( void ){
+  return hooks_active && !ckpt_replaying;
+}
+
+static void take_interrupt( int i ){
+  uint16_t vector = irqs[i].vector, old_psw = psw_get(), new_pc, new_psw;
+
+  irqs[i] = irqs[--pending];
+  interrupts_taken++;
+  sched_changes++;
+  if( waiting ){
+    reg[7] += 2;
+    waiting = false;
+  }
+  if( trace || verbose ) printf( "interrupt, vector %03o\n", vector );
+
+  /* the vector fetches and pushes are data references like RTI's pops:
+     counted, and seen by the models when they are attached */
+  psw_high &= 037777;  /* kernel mode */
+  new_pc = bus_read( vector );
+  if( hook_refs() ) call_read_hooks( inst_pc, vector );
+  new_psw = bus_read( vector + 2 );
+  if( hook_refs() ) call_read_hooks( inst_pc, vector + 2 );
+  memory_reads += 2;
+  psw_set( (new_psw & ~030000) | ((old_psw >> 2) & 030000) );
+
+  reg[6] -= 2;
+  bus_write( reg[6], old_psw );
+  if( hook_refs() ) call_write_hooks( inst_pc, reg[6] );
+  reg[6] -= 2;
+  bus_write( reg[6], reg[7] );
+  if( hook_refs() ) call_write_hooks( inst_pc, reg[6] );
+  memory_writes += 2;
+  reg[7] = new_pc;
+}
+
+void sched_service( void ){
+  int i;
+
+  while( count && heap[0].when <= sched_now() ){
+    event_fn_t fn = heap[0].fn;
+    heap[0] = heap[--count];
+    if( count ) sift_down( 0 );
+    events_fired++;
+    fn();
+  }
+  if( (i = deliverable()) >= 0 ) take_interrupt( i );
+  update_next();
+}
+
+void irq_raise( uint16_t vector, int priority ){
+  int i;
+  for( i=0; i<pending; i++ ){
+    if( irqs[i].vector == vector ) return;
+  }
+  if( pending == IRQ_MAX ) return;
+  irqs[pending].vector = vector;
+  irqs[pending].priority = priority;
+  pending++;
+  sched_changes++;
+  if( priority > ((psw_high >> 5) & 7) ) next_event = sched_now();
+}
+
+void irq_clear( uint16_t vector ){
+  int i;
+  for( i=0; i<pending; i++ ){
+    if( irqs[i].vector == vector ){
+      irqs[i] = irqs[--pending];
+      sched_changes++;
+      return;
+    }
+  }
+}
+
+void irq_check( void ){
+  if( deliverable() >= 0 ) next_event = sched_now();
+}
+
+/* queue and requests, for checkpoints */
+void events_ckpt( void ){
+  ckpt_region( heap, sizeof( heap ) );
+  ckpt_region( &count, sizeof( count ) );
+  ckpt_region( &seq, sizeof( seq ) );
+  ckpt_region( irqs, sizeof( irqs ) );
+  ckpt_region( &pending, sizeof( pending ) );
+  ckpt_region( &next_event, sizeof( next_event ) );
+  ckpt_region( &events_fired, sizeof( events_fired ) );
+  ckpt_region( &interrupts_taken, sizeof( interrupts_taken ) );
+}
+
+void sched_stats( void ){
+  printf( "event statistics (in decimal):\n" );
+  printf( "  events fired      = %llu\n", (unsigned long long)events_fired );
+  printf( "  interrupts taken  = %llu\n", (unsigned long long)interrupts_taken );
+}
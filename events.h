@@ -0,0 +1,34 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "pdp11-sim.h"
+
+#define SCHED_MAX 32  /* events outstanding at once */
+#define IRQ_MAX 8     /* interrupt requests pending at once */
+#define SCHED_NEVER UINT64_MAX
+
+typedef void (*event_fn_t)( void );
+
+extern uint64_t next_event;
+extern uint64_t events_fired, interrupts_taken;
+extern uint64_t sched_changes;
+
+void sched_at( uint64_t when, event_fn_t fn );
+void sched_cancel( event_fn_t fn );
+uint64_t sched_first( void );
+void sched_service( void );
+void irq_raise( uint16_t vector, int priority );
+void irq_clear( uint16_t vector );
+void irq_check( void );
+void events_ckpt( void );
+void sched_stats( void );
+
+/* the scheduler's clock is the instruction count */
+static inline uint64_t sched_now( void ){
+  return (uint64_t)inst_execs;
+}
+
+#endif
@@ -0,0 +1,68 @@
+/* access hooks - callbacks on instruction fetch, data read, data
+ *   write, and branch
+ *
+ * every model that watches the reference stream (the cache and the
+ *   prefetcher behind it, reuse distance, branch predictors) attaches
+ *   itself here instead of being called from the execution core
+ *
+ * routines
+ *
+ *   bool hook_fetch( access_hook_t fn );
+ *   bool hook_read( access_hook_t fn );
+ *   bool hook_write( access_hook_t fn );
+ *   bool hook_branch( branch_hook_t fn );
+ *
+ * each returns false when HOOKS_MAX callbacks are already registered
+ *   for that event; callbacks run in registration order, with pc the
+ *   address of the instruction making the access
+ *
+ * the execution core (pdp11-exec.h) is compiled twice, with and without
+ *   the call_*_hooks() dispatch; main() runs the variant without any
+ *   hook calls when hooks_active is still false after option parsing,
+ *   so an empty hook list costs nothing per access
+ */
+
+#include <stdlib.h>
+
+#include "hooks.h"
+
+access_hook_t
+  fetch_hooks[HOOKS_MAX+1],
+  read_hooks[HOOKS_MAX+1],
+  write_hooks[HOOKS_MAX+1];
+
+branch_hook_t branch_hooks[HOOKS_MAX+1];
+
+bool hooks_active = false;  /* any callback registered */
+
+static bool add_access( access_hook_t *list, access_hook_t fn ){
+  int i;
+  for( i=0; list[i]; i++ );
+  if( i == HOOKS_MAX ) return false;
+  list[i] = fn;
+  list[i+1] = NULL;
+  hooks_active = true;
+  return true;
+}
+
+bool hook_fetch( access_hook_t fn ){
+  return add_access( fetch_hooks, fn );
+}
+
+bool hook_read( access_hook_t fn ){
+  return add_access( read_hooks, fn );
+}
+
+bool hook_write( access_hook_t fn ){
+  return add_access( write_hooks, fn );
+}
+
+bool hook_branch( branch_hook_t fn ){
+  int i;
+  for( i=0; branch_hooks[i]; i++ );
+  if( i == HOOKS_MAX ) return false;
+  branch_hooks[i] = fn;
+  branch_hooks[i+1] = NULL;
+  hooks_active = true;
+  return true;
+}
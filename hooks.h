@@ -0,0 +1,44 @@
+#ifndef HOOKS_H
+#define HOOKS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define HOOKS_MAX 8  /* callbacks per event */
+
+typedef void (*access_hook_t)( uint16_t pc, uint16_t address );
+typedef void (*branch_hook_t)( uint16_t pc, uint16_t target, bool taken );
+
+extern bool hooks_active;
+
+/* registered callbacks, each list ends with NULL */
+extern access_hook_t fetch_hooks[HOOKS_MAX+1], read_hooks[HOOKS_MAX+1],
+                     write_hooks[HOOKS_MAX+1];
+extern branch_hook_t branch_hooks[HOOKS_MAX+1];
+
+bool hook_fetch( access_hook_t fn );
+bool hook_read( access_hook_t fn );
+bool hook_write( access_hook_t fn );
+bool hook_branch( branch_hook_t fn );
+
+static inline void call_fetch_hooks( uint16_t pc, uint16_t address ){
+  access_hook_t *h;
+  for( h=fetch_hooks; *h; h++ ) (*h)( pc, address );
+}
+
+static inline void call_read_hooks( uint16_t pc, uint16_t address ){
+  access_hook_t *h;
+  for( h=read_hooks; *h; h++ ) (*h)( pc, address );
+}
+
+static inline void call_write_hooks( uint16_t pc, uint16_t address ){
+  access_hook_t *h;
+  for( h=write_hooks; *h; h++ ) (*h)( pc, address );
+}
+
+static inline void call_branch_hooks( uint16_t pc, uint16_t target, bool taken ){
+  branch_hook_t *h;
+  for( h=branch_hooks; *h; h++ ) (*h)( pc, target, taken );
+}
+
+#endif
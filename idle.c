@@ -0,0 +1,123 @@
+/* idle loop fast-forward
+ *
+ * routines
+ *
+ *   void idle_check( void );
+ *   void idle_stats( void );
+ *
+ * the run loops call idle_check() after a transfer back to an earlier
+ *   or the same address (a taken backward branch, or WAIT executing
+ *   again) while an event is scheduled
+ *
+ * the first time a loop head is seen the machine state is recorded;
+ *   the next time it is reached, if registers, PSW and WAIT state are
+ *   unchanged, the iteration wrote no memory, missed neither the cache
+ *   nor the translation cache, and left the event queue and interrupt
+ *   requests alone, every later iteration does exactly the same until
+ *   the next event fires: `br .`, WAIT and polling loops of compares
+ *   and branches; the counters are then advanced by as many whole
+ *   iterations as fit before next_event, and execution resumes there
+ *
+ * the reference stream models other than the cache keep state that
+ *   a bulk skip cannot reproduce, so main() leaves idle_active clear
+ *   when any of them is on
+ */
+
+#include <stdio.h>
+
+#include "idle.h"
+#include "pdp11-sim.h"
+#include "events.h"
+#include "cache.h"
+#include "mmu.h"
+
+typedef struct {
+  uint16_t regs[8];
+  uint16_t psw;
+  bool waiting;
+  int execs, fetches, reads, writes, branches, taken;
+  unsigned int cache_reads, hits, misses;
+  uint64_t tlb_hits, tlb_misses, changes;
+} idle_state_t;
+
+static idle_state_t last;   /* state at the loop head last time */
+static bool last_valid = false;
+
+bool idle_active = true;   /* fast-forward idle loops */
+uint64_t
+  idle_skipped = 0,        /* instructions accounted without executing */
+  idle_loops = 0;          /* times a loop was skipped */
+
+static void record( idle_state_t *s ){
+  int i;
+  for( i=0; i<8; i++ ) s->regs[i] = reg[i];
+  s->psw = psw_get();
+  s->waiting = waiting;
+  s->execs = inst_execs;
+  s->fetches = inst_fetches;
+  s->reads = memory_reads;
+  s->writes = memory_writes;
+  s->branches = branch_execs;
+  s->taken = branch_taken;
+  s->cache_reads = cache_reads;
+  s->hits = hits;
+  s->misses = misses;
+  s->tlb_hits = tlb_hits;
+  s->tlb_misses = tlb_misses;
+  s->changes = sched_changes;
+}
+
+static bool idle_iteration( idle_state_t *now ){
+  int i;
+  for( i=0; i<8; i++ ){
+    if( now->regs[i] != last.regs[i] ) return false;
+  }
+  return now->psw == last.psw && now->waiting == last.waiting
+    && now->execs > last.execs && now->execs - last.execs <= IDLE_MAX_LOOP
+    && now->writes == last.writes && now->misses == last.misses
+    && now->tlb_misses == last.tlb_misses && now->changes == last.changes;
+}
+
+void idle_check( void ){
+  idle_state_t now;
+  uint64_t k;
+  int per;
+
+  if( !last_valid || reg[7] != last.regs[7] ){
+    record( &last );
+    last_valid = true;
+    return;
+  }
+  record( &now );
+  if( !idle_iteration( &now ) ){
+    last = now;
+    return;
+  }
+
+  /* whole iterations that end before the next event */
+  per = now.execs - last.execs;
+  k = (next_event - sched_now()) / per;
+  if( k == 0 ) return;
+
+  inst_execs += k * per;
+  inst_fetches += k * (now.fetches - last.fetches);
+  memory_reads += k * (now.reads - last.reads);
+  branch_execs += k * (now.branches - last.branches);
+  branch_taken += k * (now.taken - last.taken);
+  cache_reads += k * (now.cache_reads - last.cache_reads);
+  hits += k * (now.hits - last.hits);
+  tlb_hits += k * (now.tlb_hits - last.tlb_hits);
+
+  idle_skipped += k * per;
+  idle_loops++;
+  last_valid = false;
+
+  /* the loop test after the last skipped instruction */
+  if( sched_now() >= next_event ) sched_service();
+}
+
+void idle_stats( void ){
+  printf( "idle statistics (in decimal):\n" );
+  printf( "  loops skipped     = %llu\n", (unsigned long long)idle_loops );
+  printf( "  insts skipped     = %llu\n", (unsigned long long)idle_skipped );
+}
@@ -0,0 +1,15 @@
+#ifndef IDLE_H
+#define IDLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define IDLE_MAX_LOOP 8  /* longest loop, in instructions, that is skipped */
+
+extern bool idle_active;
+extern uint64_t idle_skipped;
+
+void idle_check( void );
+void idle_stats( void );
+
+#endif
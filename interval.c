@@ -0,0 +1,159 @@
+/* interval statistics time series
+ *
+ * every N guest instructions the global counters are copied into a
+ *   preallocated in-memory buffer; at exit the buffer is written out
+ *   as per-interval deltas, so miss rate and IPC can be plotted over
+ *   the run without tracing every access
+ *
+ * routines
+ *
+ *   bool interval_init( const char *spec );
+ *   void interval_sample( void );
+ *   void interval_write( void );
+ *
+ * spec is "<N>,<file>"; a file name ending in ".bin" selects the
+ *   binary format, anything else gets CSV
+ *
+ * the instrumented main loop calls interval_sample() whenever
+ *   inst_execs reaches interval_next; interval_write() takes a final
+ *   sample for the partial last interval before writing
+ *
+ * the buffer starts with room for INTERVAL_PREALLOC samples and is
+ *   doubled if a run outgrows it, so sampling never allocates in the
+ *   common case
+ *
+ * CSV columns are deltas over the interval; cycles and ipc are 0 unless
+ *   the timing model (-T) is on
+ *
+ * binary format, all little-endian
+ *
+ *   char     magic[8]   "PDPIVL1\0"
+ *   uint32_t fields     number of uint64_t per record (INTERVAL_FIELDS)
+ *   uint32_t interval   N
+ *   uint64_t record[fields] ...   cumulative counters, field order as
+ *                                 in the CSV from end_inst through cycles
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pdp11-sim.h"
+#include "cache.h"
+#include "timing.h"
+#include "interval.h"
+
+#define INTERVAL_PREALLOC 4096
+
+enum { F_INSTS, F_FETCHES, F_READS, F_WRITES, F_BRANCHES, F_TAKEN,
+       F_CACHE_READS, F_CACHE_WRITES, F_HITS, F_MISSES, F_WRITE_BACKS,
+       F_CYCLES, INTERVAL_FIELDS };
+
+static const char *field_names[INTERVAL_FIELDS] = {
+  "insts", "fetches", "reads", "writes", "branches", "taken",
+  "cache_reads", "cache_writes", "hits", "misses", "write_backs", "cycles"
+};
+
+typedef struct {
+  uint64_t f[INTERVAL_FIELDS];
+} sample_t;
+
+static sample_t *samples = NULL;
+static size_t num_samples = 0, capacity = 0;
+static int interval = 0;
+static const char *path = NULL;
+
+bool interval_active = false;
+int interval_next = 0;
+
+bool interval_init( const char *spec ){
+  char *end;
+  long n = strtol( spec, &end, 10 );
+  if( n <= 0 || *end != ',' || end[1] == '\0' ) return false;
+
+  interval = n;
+  path = end+1;
+  capacity = INTERVAL_PREALLOC;
+  samples = malloc( capacity * sizeof( sample_t ) );
+  num_samples = 0;
+  interval_next = interval;
+  interval_active = true;
+  return true;
+}
+
+void interval_sample( void ){
+  sample_t *s;
+
+  if( num_samples == capacity ){
+    capacity *= 2;
+    samples = realloc( samples, capacity * sizeof( sample_t ) );
+  }
+  s = &samples[num_samples++];
+
+  s->f[F_INSTS] = inst_execs;
+  s->f[F_FETCHES] = inst_fetches;
+  s->f[F_READS] = memory_reads;
+  s->f[F_WRITES] = memory_writes;
+  s->f[F_BRANCHES] = branch_execs;
+  s->f[F_TAKEN] = branch_taken;
+  s->f[F_CACHE_READS] = cache_reads;
+  s->f[F_CACHE_WRITES] = cache_writes;
+  s->f[F_HITS] = hits;
+  s->f[F_MISSES] = misses;
+  s->f[F_WRITE_BACKS] = write_backs;
+  s->f[F_CYCLES] = cycles;
+
+  interval_next += interval;
+}
+
+static void write_csv( FILE *fp ){
+  sample_t prev;
+  size_t i;
+  int f;
+
+  memset( &prev, 0, sizeof( prev ) );
+  fprintf( fp, "interval,end_inst" );
+  for( f=0; f<INTERVAL_FIELDS; f++ ) fprintf( fp, ",%s", field_names[f] );
+  fprintf( fp, ",miss_rate,ipc\n" );
+
+  for( i=0; i<num_samples; i++ ){
+    sample_t *s = &samples[i];
+    uint64_t d[INTERVAL_FIELDS];
+    uint64_t accesses;
+
+    for( f=0; f<INTERVAL_FIELDS; f++ ) d[f] = s->f[f] - prev.f[f];
+    accesses = d[F_HITS] + d[F_MISSES];
+
+    fprintf( fp, "%zu,%llu", i, (unsigned long long)s->f[F_INSTS] );
+    for( f=0; f<INTERVAL_FIELDS; f++ ) fprintf( fp, ",%llu", (unsigned long long)d[f] );
+    fprintf( fp, ",%0.6f,%0.6f\n",
+             accesses ? (double)d[F_MISSES] / accesses : 0.0,
+             d[F_CYCLES] ? (double)d[F_INSTS] / d[F_CYCLES] : 0.0 );
+    prev = *s;
+  }
+}
+
+static void write_binary( FILE *fp ){
+  uint32_t header[2] = { INTERVAL_FIELDS, interval };
+  fwrite( "PDPIVL1", 1, 8, fp );
+  fwrite( header, sizeof( header ), 1, fp );
+  fwrite( samples, sizeof( sample_t ), num_samples, fp );
+}
+
+void interval_write( void ){
+  size_t len = strlen( path );
+  FILE *fp;
+
+  /* close out the last, partial interval */
+  if( num_samples == 0 || samples[num_samples-1].f[F_INSTS] != (uint64_t)inst_execs ){
+    interval_sample();
+  }
+
+  fp = fopen( path, "wb" );
+  if( fp == NULL ){
+    printf( "cannot write interval statistics to %s\n", path );
+    return;
+  }
+  if( len > 4 && strcmp( path+len-4, ".bin" ) == 0 ) write_binary( fp );
+  else write_csv( fp );
+  fclose( fp );
+}
@@ -0,0 +1,14 @@
+#ifndef INTERVAL_H
+#define INTERVAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+extern bool interval_active;
+extern int interval_next;
+
+bool interval_init( const char *spec );
+void interval_sample( void );
+void interval_write( void );
+
+#endif
@@ -0,0 +1,155 @@
+/* record and replay of external input
+ *
+ * routines
+ *
+ *   bool journal_record( const char *path );
+ *   bool journal_replay( const char *path );
+ *   int journal_input( int (*live)( void ) );
+ *   void journal_ckpt( void );
+ *   void journal_stats( void );
+ *
+ * everything else in the machine follows from the instruction count, so
+ *   a run is repeatable once the input it polled is: a device asks
+ *   journal_input() for its next input instead of calling live(), which
+ *   returns a byte, INPUT_NONE when nothing has arrived yet (a terminal
+ *   or pipe), or EOF; interrupts and the events behind them then come at
+ *   the same instruction counts as the recorded run
+ *
+ * recording keeps every byte and EOF with the instruction count it was
+ *   polled at; a poll that finds nothing is not kept, so the journal
+ *   grows with the input, not the run; replaying answers each poll from
+ *   the journal, with INPUT_NONE until the next record is due
+ *
+ * a record is a varint of (count since the last record) * 2, plus 1 for
+ *   EOF, then the byte unless it is EOF; the file starts with
+ *   JOURNAL_MAGIC
+ *
+ * journal_stats() reports the records and bytes up to the current
+ *   position, which are the same whether the run recorded or replayed
+ *
+ * the journal position is part of a checkpoint; a restored run that
+ *   is recording reads back what it recorded until it catches up, then
+ *   polls live() again
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "journal.h"
+#include "events.h"
+#include "ckpt.h"
+
+#define JOURNAL_MAGIC "PDP11JRN"
+
+static FILE *journal = NULL;
+static bool recording = false;
+static long
+  position,           /* offset of the next record */
+  end;                /* offset past the last record */
+static uint64_t last_count = 0;  /* count of the record before position */
+
+bool journal_active = false;  /* input goes through a journal */
+uint64_t journal_records = 0;  /* records up to position, written or read */
+
+static bool open_journal( const char *path, const char *mode ){
+  char magic[sizeof( JOURNAL_MAGIC ) - 1];
+
+  journal = fopen( path, mode );
+  if( journal == NULL ) return false;
+  if( recording ){
+    if( fwrite( JOURNAL_MAGIC, 1, sizeof( magic ), journal ) != sizeof( magic ) ) return false;
+  }else{
+    if( fread( magic, 1, sizeof( magic ), journal ) != sizeof( magic ) ||
+        memcmp( magic, JOURNAL_MAGIC, sizeof( magic ) ) != 0 ) return false;
+  }
+  position = ftell( journal );
+  fseek( journal, 0, SEEK_END );
+  end = ftell( journal );
+  journal_active = true;
+  return true;
+}
+
+bool journal_record( const char *path ){
+  recording = true;
+  return open_journal( path, "w+b" );
+}
+
+bool journal_replay( const char *path ){
+  recording = false;
+  return open_journal( path, "rb" );
+}
+
+static void put_varint( uint64_t x ){
+  while( x >= 0200 ){
+    fputc( (x & 0177) | 0200, journal );
+    x >>= 7;
+  }
+  fputc( x, journal );
+}
+
+static bool get_varint( uint64_t *x ){
+  int b, shift = 0;
+  *x = 0;
+  do{
+    if( (b = fgetc( journal )) == EOF || shift > 63 ) return false;
+    *x |= (uint64_t)(b & 0177) << shift;
+    shift += 7;
+  }while( b & 0200 );
+  return true;
+}
+
+/* the record at position, without moving past it */
+static bool peek( uint64_t *count, int *ch, long *next ){
+  uint64_t x;
+
+  fseek( journal, position, SEEK_SET );
+  if( !get_varint( &x ) ) return false;
+  *count = last_count + (x >> 1);
+  if( x & 1 ) *ch = EOF;
+  else if( (*ch = fgetc( journal )) == EOF ) return false;
+  *next = ftell( journal );
+  return true;
+}
+
+int journal_input( int (*live)( void ) ){
+  uint64_t now = sched_now(), count;
+  long next;
+  int ch;
+
+  /* replaying, or a restored run behind what it recorded */
+  if( position < end ){
+    if( !peek( &count, &ch, &next ) || count < now ){
+      printf( "Journal out of step at instruction %llu\n", (unsigned long long)now );
+      exit( 1 );
+    }
+    if( count > now ) return INPUT_NONE;
+    position = next;
+    last_count = count;
+    journal_records++;
+    return ch;
+  }
+  if( !recording ) return INPUT_NONE;
+
+  if( (ch = live()) == INPUT_NONE ) return ch;
+  fseek( journal, end, SEEK_SET );
+  put_varint( ((now - last_count) << 1) | (ch == EOF) );
+  if( ch != EOF ) fputc( ch, journal );
+  fflush( journal );
+  position = end = ftell( journal );
+  last_count = now;
+  journal_records++;
+  return ch;
+}
+
+void journal_ckpt( void ){
+  ckpt_region( &position, sizeof( position ) );
+  ckpt_region( &last_count, sizeof( last_count ) );
+  ckpt_region( &journal_records, sizeof( journal_records ) );
+}
+
+void journal_stats( void ){
+  printf( "journal statistics (in decimal):\n" );
+  printf( "  input records     = %llu\n", (unsigned long long)journal_records );
+  printf( "  journal bytes     = %ld\n", position );
+}
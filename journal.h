@@ -0,0 +1,17 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define INPUT_NONE (-2)  /* nothing has arrived yet; EOF is the end */
+
+extern bool journal_active;
+
+bool journal_record( const char *path );
+bool journal_replay( const char *path );
+int journal_input( int (*live)( void ) );
+void journal_ckpt( void );
+void journal_stats( void );
+
+#endif
@@ -0,0 +1,328 @@
+/* guest image loaders
+ *
+ * routines
+ *
+ *   int load_format( const char *name );
+ *   bool load_image( const char *path, int format, uint16_t load_addr,
+ *                    int32_t *start );
+ *   bool save_memory( const char *path );
+ *   bool map_memory( const char *path );
+ *   bool resident_kb( unsigned long *rss, unsigned long *shared );
+ *
+ * load_format() maps "octal", "bin", "lda", or "aout" to a LOAD_*
+ *   format, or returns -1; load_image() reads path ("-" or NULL for
+ *   stdin) into memory[] starting at load_addr, and sets *start to the
+ *   entry point the image names, or leaves it alone if there is none;
+ *   it prints a message and returns false on any error
+ *
+ * formats
+ *
+ *   octal  the original text format: one word per line, as octal digits
+ *          after optional blanks; anything after the digits (such as
+ *          the "; address label: source" annotation in bench/) is
+ *          ignored, and a line without digits loads a zero word
+ *   bin    raw little-endian image, word 0 at load_addr
+ *   lda    PDP-11 absolute loader (paper tape) blocks: 001 000, byte
+ *          count (including the 6-byte header), load address, data,
+ *          checksum; a block with no data ends the tape and gives the
+ *          start address, which is ignored if odd; load_addr is added
+ *          to every block address as a relocation offset
+ *   aout   UNIX V6/V7 a.out: header magic 0407 or 0410, then text and
+ *          data sizes, bss size, symbol table size, entry point; text
+ *          is loaded at load_addr, data follows it (0407) or starts at
+ *          the next 8 KiB boundary (0410), and bss is cleared; entry is
+ *          offset by load_addr, relocation records are not applied
+ *
+ * LOAD_AUTO picks the format from the file name: .bin, .lda (or .ptap),
+ *   .out, and everything else (including stdin) as octal text
+ *
+ * files are mapped with mmap() and parsed in place, stdin is read in
+ *   one pass into a buffer; the time spent is left in load_ns
+ *
+ * memory images
+ *
+ *   save_memory() writes memory[] as it is in the simulator (MEMSIZE
+ *   host-order words, one per byte address), and map_memory() maps
+ *   such a file MAP_PRIVATE in place of the static array; pages the
+ *   guest only reads stay shared with every other process mapping the
+ *   same file through the host page cache, and the first write to a
+ *   page gives this process a private copy
+ *
+ *   resident_kb() reports this process's resident set and the part of
+ *   it that is file-backed (shared), from /proc/self/statm
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "pdp11-sim.h"
+#include "loader.h"
+
+uint64_t load_ns = 0;  /* host time spent in load_image() */
+
+int load_format( const char *name ){
+  if( strcmp( name, "octal" ) == 0 ) return LOAD_OCTAL;
+  if( strcmp( name, "bin" ) == 0 ) return LOAD_BINARY;
+  if( strcmp( name, "lda" ) == 0 ) return LOAD_LDA;
+  if( strcmp( name, "aout" ) == 0 ) return LOAD_AOUT;
+  return -1;
+}
+
+static int guess_format( const char *path ){
+  const char *dot;
+  if( path == NULL ) return LOAD_OCTAL;
+  dot = strrchr( path, '.' );
+  if( dot == NULL ) return LOAD_OCTAL;
+  if( strcmp( dot, ".bin" ) == 0 ) return LOAD_BINARY;
+  if( strcmp( dot, ".lda" ) == 0 || strcmp( dot, ".ptap" ) == 0 ) return LOAD_LDA;
+  if( strcmp( dot, ".out" ) == 0 ) return LOAD_AOUT;
+  return LOAD_OCTAL;
+}
+
+static bool put_word( uint32_t addr, uint16_t word ){
+  if( addr + 1 >= MEMSIZE ){
+    printf( "Image does not fit in memory at %06o\n", addr );
+    return false;
+  }
+  memory[addr] = word;
+  if( verbose ) printf( "  %07o\n", word );
+  return true;
+}
+
+static bool put_byte( uint32_t addr, uint8_t byte ){
+  if( addr >= MEMSIZE ){
+    printf( "Image does not fit in memory at %06o\n", addr );
+    return false;
+  }
+  if( addr & 1 ) memory[addr & ~1] = (memory[addr & ~1] & 0x00FF) | (byte << 8);
+  else memory[addr] = (memory[addr] & 0xFF00) | byte;
+  return true;
+}
+
+static uint16_t get_word( const uint8_t *p ){
+  return p[0] | (p[1] << 8);
+}
+
+/* the text format, one word per line */
+
+static bool load_octal( const uint8_t *p, size_t len, uint32_t addr ){
+  const uint8_t *end = p + len;
+  unsigned int word;
+
+  if( verbose ) printf( "\nreading words in octal from stdin:\n" );
+  while( p < end ){
+    while( p < end && (*p == ' ' || *p == '\t') ) p++;
+    word = 0;
+    while( p < end && *p >= '0' && *p <= '7' ) word = (word << 3) | (*p++ - '0');
+    while( p < end && *p != '\n' ) p++;
+    if( p < end ) p++;
+    if( !put_word( addr, word ) ) return false;
+    addr += 2;
+  }
+  return true;
+}
+
+static bool load_binary( const uint8_t *p, size_t len, uint32_t addr ){
+  size_t i;
+  if( verbose ) printf( "\nreading binary image:\n" );
+  for( i=0; i+1<len; i+=2 ){
+    if( !put_word( addr + i, get_word( p + i ) ) ) return false;
+  }
+  if( len & 1 ) return put_byte( addr + len - 1, p[len-1] );
+  return true;
+}
+
+static bool load_lda( const uint8_t *p, size_t len, uint32_t offset, int32_t *start ){
+  size_t pos = 0, i;
+  unsigned int count, addr;
+  uint8_t sum;
+
+  if( verbose ) printf( "\nreading absolute loader blocks:\n" );
+  for( ;; ){
+
+    /* skip leader up to the 001 000 block mark */
+
+    while( pos < len && p[pos] == 0 ) pos++;
+    if( pos + 6 > len || p[pos] != 1 || p[pos+1] != 0 ){
+      printf( "Bad absolute loader block at byte %zu\n", pos );
+      return false;
+    }
+    count = get_word( p + pos + 2 );
+    addr = get_word( p + pos + 4 );
+    if( count < 6 || pos + count + 1 > len ){
+      printf( "Bad absolute loader block length at byte %zu\n", pos );
+      return false;
+    }
+    sum = 0;
+    for( i=0; i<=count; i++ ) sum += p[pos+i];
+    if( sum != 0 ){
+      printf( "Absolute loader checksum error at byte %zu\n", pos );
+      return false;
+    }
+    if( count == 6 ){
+      if( !(addr & 1) ) *start = (addr + offset) & 0xFFFF;
+      return true;
+    }
+    if( verbose ) printf( "  block at %06o, %u bytes\n", addr, count - 6 );
+    for( i=6; i<count; i++ ){
+      if( !put_byte( addr + offset + i - 6, p[pos+i] ) ) return false;
+    }
+    pos += count + 1;
+  }
+}
+
+static bool load_aout( const uint8_t *p, size_t len, uint32_t addr, int32_t *start ){
+  unsigned int magic, text, data, bss, entry, data_addr, i;
+
+  if( len < 16 ){
+    printf( "a.out header truncated\n" );
+    return false;
+  }
+  magic = get_word( p );
+  text = get_word( p + 2 );
+  data = get_word( p + 4 );
+  bss = get_word( p + 6 );
+  entry = get_word( p + 10 );
+  if( magic != 0407 && magic != 0410 ){
+    printf( "Unsupported a.out magic %06o\n", magic );
+    return false;
+  }
+  if( 16 + (size_t)text + data > len ){
+    printf( "a.out image truncated\n" );
+    return false;
+  }
+
+  data_addr = addr + text;
+  if( magic == 0410 ) data_addr = (data_addr + 017777) & ~017777;
+
+  if( verbose ) printf( "\nreading a.out text:\n" );
+  if( !load_binary( p + 16, text, addr ) ) return false;
+  if( verbose ) printf( "\nreading a.out data:\n" );
+  if( !load_binary( p + 16 + text, data, data_addr ) ) return false;
+  for( i=0; i<bss; i++ ){
+    if( !put_byte( data_addr + data + i, 0 ) ) return false;
+  }
+  *start = (entry + addr) & 0xFFFF;
+  return true;
+}
+
+bool save_memory( const char *path ){
+  FILE *f = fopen( path, "wb" );
+  if( f == NULL || fwrite( memory, sizeof( memory[0] ), MEMSIZE, f ) != MEMSIZE ){
+    printf( "Cannot write memory image: %s\n", path );
+    if( f != NULL ) fclose( f );
+    return false;
+  }
+  fclose( f );
+  return true;
+}
+
+bool map_memory( const char *path ){
+  struct timespec t0, t1;
+  struct stat st;
+  void *p;
+  int fd;
+
+  clock_gettime( CLOCK_MONOTONIC, &t0 );
+  fd = open( path, O_RDONLY );
+
+  if( fd < 0 || fstat( fd, &st ) < 0 ){
+    printf( "Cannot open memory image: %s\n", path );
+    if( fd >= 0 ) close( fd );
+    return false;
+  }
+  if( st.st_size != MEMSIZE * sizeof( memory[0] ) ){
+    printf( "Memory image is %lld bytes, expected %zu: %s\n",
+            (long long)st.st_size, MEMSIZE * sizeof( memory[0] ), path );
+    close( fd );
+    return false;
+  }
+  p = mmap( NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+  close( fd );
+  if( p == MAP_FAILED ){
+    printf( "Cannot map memory image: %s\n", path );
+    return false;
+  }
+  memory = p;
+
+  clock_gettime( CLOCK_MONOTONIC, &t1 );
+  load_ns = (uint64_t)(t1.tv_sec - t0.tv_sec) * 1000000000 + (t1.tv_nsec - t0.tv_nsec);
+  return true;
+}
+
+bool resident_kb( unsigned long *rss, unsigned long *shared ){
+  unsigned long size, resident, file;
+  long page = sysconf( _SC_PAGESIZE ) / 1024;
+  FILE *f = fopen( "/proc/self/statm", "r" );
+  if( f == NULL ) return false;
+  if( fscanf( f, "%lu %lu %lu", &size, &resident, &file ) != 3 ){
+    fclose( f );
+    return false;
+  }
+  fclose( f );
+  *rss = resident * page;
+  *shared = file * page;
+  return true;
+}
+
+bool load_image( const char *path, int format, uint16_t load_addr, int32_t *start ){
+  struct timespec t0, t1;
+  struct stat st;
+  uint8_t *p = NULL;
+  size_t len = 0, cap = 0, got;
+  bool mapped = false, ok = false;
+  int fd;
+
+  clock_gettime( CLOCK_MONOTONIC, &t0 );
+  if( path != NULL && strcmp( path, "-" ) == 0 ) path = NULL;
+  if( format == LOAD_AUTO ) format = guess_format( path );
+
+  if( path == NULL ){
+    do{
+      if( len == cap ){
+        cap = cap ? 2*cap : 65536;
+        p = realloc( p, cap );
+      }
+      got = fread( p + len, 1, cap - len, stdin );
+      len += got;
+    }while( got > 0 );
+  }else{
+    fd = open( path, O_RDONLY );
+    if( fd < 0 || fstat( fd, &st ) < 0 ){
+      printf( "Cannot open image: %s\n", path );
+      if( fd >= 0 ) close( fd );
+      return false;
+    }
+    len = st.st_size;
+    if( len > 0 ){
+      p = mmap( NULL, len, PROT_READ, MAP_PRIVATE, fd, 0 );
+      if( p == MAP_FAILED ){
+        printf( "Cannot map image: %s\n", path );
+        close( fd );
+        return false;
+      }
+      mapped = true;
+    }
+    close( fd );
+  }
+
+  switch( format ){
+    case LOAD_OCTAL:  ok = load_octal( p, len, load_addr ); break;
+    case LOAD_BINARY: ok = load_binary( p, len, load_addr ); break;
+    case LOAD_LDA:    ok = load_lda( p, len, load_addr, start ); break;
+    case LOAD_AOUT:   ok = load_aout( p, len, load_addr, start ); break;
+  }
+
+  if( mapped ) munmap( p, len );
+  else free( p );
+
+  clock_gettime( CLOCK_MONOTONIC, &t1 );
+  load_ns = (uint64_t)(t1.tv_sec - t0.tv_sec) * 1000000000 + (t1.tv_nsec - t0.tv_nsec);
+  return ok;
+}
@@ -0,0 +1,17 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+enum { LOAD_AUTO, LOAD_OCTAL, LOAD_BINARY, LOAD_LDA, LOAD_AOUT };
+
+extern uint64_t load_ns;
+
+int load_format( const char *name );
+bool load_image( const char *path, int format, uint16_t load_addr, int32_t *start );
+bool save_memory( const char *path );
+bool map_memory( const char *path );
+bool resident_kb( unsigned long *rss, unsigned long *shared );
+
+#endif
@@ -0,0 +1,181 @@
+/* closed-form sob loops
+ *
+ * routines
+ *
+ *   bool loop_run( bool hooked );
+ *   void loop_stats( void );
+ *
+ * the run loops call loop_run() when a sob has just branched back over
+ *   a single instruction, i.e. PC is two words below the sob; if that
+ *   instruction is one of
+ *
+ *     mov rS,(rD)+      fill
+ *     mov (rS)+,(rD)+   copy
+ *     add rS,rD         register add
+ *     sub rS,rD         register subtract
+ *
+ *   with rS, rD and the count register all different and in r0-r5, the
+ *   remaining iterations (the count register's value) are done at once:
+ *   memory, registers, condition codes and the execution counters end up
+ *   as step-by-step execution leaves them, and with hooked set the same
+ *   fetch, read, write and branch events are passed to the access hooks
+ *   in the same order, so the cache and the other models see nothing
+ *   different
+ *
+ * anything else returns false and is interpreted as usual, as are
+ *   loops with a count of 0 (65536 trips), loops that would reference
+ *   the I/O page, wrap around the address space or store over their own
+ *   code, and all loops while the MMU is translating; the loop stops
+ *   early, with the sob taken, where the next scheduled event is due
+ *
+ * memory holds one word per even byte address, so a fill or copy is a
+ *   stride-2 host loop rather than memset()/memcpy()
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "loops.h"
+#include "pdp11-sim.h"
+#include "events.h"
+#include "hooks.h"
+#include "unibus.h"
+#include "mmu.h"
+
+enum { L_FILL, L_COPY, L_ADD, L_SUB };
+
+bool loops_active = true;   /* run recognised loops in closed form */
+uint64_t
+  loops_run = 0,            /* loops done in closed form */
+  loop_insts = 0;           /* instructions they stood for */
+
+/* a word range of the loop's stores or loads: RAM only, no wrap */
+static bool in_ram( uint16_t base, uint32_t words ){
+  return !(base & 1) && (uint32_t)base + 2*words <= IOPAGE;
+}
+
+bool loop_run( bool hooked ){
+  uint16_t body = reg[7], sob_pc = body + 2;
+  uint16_t inst = memory[body], sob = memory[sob_pc];
+  int count_reg = (sob >> 6) & 7, s, d, kind;
+  uint32_t trips, i;
+  uint16_t a, b, value = 0, old = 0;
+
+  if( mmu_on || (sob & 0177000) != 077000 || (sob & 077) != 2 ) return false;
+
+  s = (inst >> 6) & 7;
+  d = inst & 7;
+  switch( inst & 0170000 ){
+    case 0010000:
+      if( (inst & 07070) == 00020 ) kind = L_FILL;
+      else if( (inst & 07070) == 02020 ) kind = L_COPY;
+      else return false;
+      break;
+    case 0060000: kind = L_ADD; break;
+    case 0160000: kind = L_SUB; break;
+    default: return false;
+  }
+  if( (kind == L_ADD || kind == L_SUB) && (inst & 07070) != 0 ) return false;
+  if( s > 5 || d > 5 || count_reg > 5 || s == d || s == count_reg || d == count_reg ) return false;
+
+  /* trips left, cut short where the next event falls due */
+  trips = reg[count_reg];
+  if( trips == 0 ) return false;
+  if( next_event != SCHED_NEVER ){
+    uint64_t room = (next_event - sched_now()) / 2;
+    if( room == 0 ) return false;
+    if( room < trips ) trips = room;
+  }
+
+  a = reg[s];
+  b = reg[d];
+  if( kind == L_FILL || kind == L_COPY ){
+    if( !in_ram( b, trips ) ) return false;
+    if( b < sob_pc + 2 && (uint32_t)b + 2*trips > body ) return false;
+    if( kind == L_COPY && !in_ram( a, trips ) ) return false;
+  }
+
+  /* the data, forward in the same order as the interpreter */
+  switch( kind ){
+    case L_FILL:
+      value = a;
+      for( i=0; i<trips; i++ ) memory[b + 2*i] = value;
+      reg[d] = b + 2*trips;
+      break;
+    case L_COPY:
+      for( i=0; i<trips; i++ ) memory[b + 2*i] = memory[a + 2*i];
+      value = memory[b + 2*(trips-1)];
+      reg[s] = a + 2*trips;
+      reg[d] = b + 2*trips;
+      break;
+    case L_ADD:
+      old = b + a * (trips - 1);
+      value = old + a;
+      reg[d] = value;
+      break;
+    case L_SUB:
+      old = b - a * (trips - 1);
+      value = old - a;
+      reg[d] = value;
+      break;
+  }
+
+  /* pages the stores covered */
+  if( kind == L_FILL || kind == L_COPY ){
+    for( i = b >> PAGE_SHIFT; i <= (b + 2*(trips-1)) >> PAGE_SHIFT; i++ ) mark_dirty( i << PAGE_SHIFT );
+  }
+
+  /* the reference stream, one iteration at a time */
+  if( hooked ){
+    for( i=0; i<trips; i++ ){
+      call_fetch_hooks( body, body );
+      if( kind == L_COPY ) call_read_hooks( body, a + 2*i );
+      if( kind == L_FILL || kind == L_COPY ){
+        call_read_hooks( body, b + 2*i );
+        call_write_hooks( body, b + 2*i );
+      }
+      call_fetch_hooks( sob_pc, sob_pc );
+      call_branch_hooks( sob_pc, body, reg[count_reg] - i - 1 != 0 );
+    }
+  }
+
+  /* condition codes of the last body instruction */
+  n = value >> 15;
+  z = value == 0;
+  switch( kind ){
+    case L_FILL: case L_COPY:
+      v = c = 0;
+      break;
+    case L_ADD:
+      v = ((old >> 15) == (a >> 15)) && ((value >> 15) != (a >> 15));
+      c = value < old;
+      break;
+    case L_SUB:
+      v = (a & 0x8000) != (old & 0x8000);
+      c = a > old;
+      break;
+  }
+
+  /* counters, and the sob that ends the last trip */
+  reg[count_reg] -= trips;
+  inst_execs += 2*trips;
+  inst_fetches += 2*trips;
+  branch_execs += trips;
+  branch_taken += trips;
+  if( kind == L_FILL || kind == L_COPY ) memory_writes += trips;
+  if( reg[count_reg] == 0 ){
+    branch_taken--;
+    reg[7] = sob_pc + 2;
+  }
+  inst_pc = sob_pc;
+
+  loops_run++;
+  loop_insts += 2*trips;
+  return true;
+}
+
+void loop_stats( void ){
+  printf( "closed-form loop statistics (in decimal):\n" );
+  printf( "  loops run         = %llu\n", (unsigned long long)loops_run );
+  printf( "  insts covered     = %llu\n", (unsigned long long)loop_insts );
+}
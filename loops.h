@@ -0,0 +1,13 @@
+#ifndef LOOPS_H
+#define LOOPS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+extern bool loops_active;
+extern uint64_t loops_run, loop_insts;
+
+bool loop_run( bool hooked );
+void loop_stats( void );
+
+#endif
@@ -0,0 +1,253 @@
+/**
+ * @file microbench.c
+ * @brief Host microbenchmarks for the simulator's hot paths
+ *
+ * Times cache_access(), get_operand() for every addressing mode,
+ * operate() dispatch, and each opcode handler in isolation. Every kernel
+ * is warmed up, then timed over repeated samples of a fixed number of
+ * calls; the per-call median and percentiles are reported in ns (and in
+ * TSC ticks on x86). The process is pinned to one core so samples are
+ * not spread across CPUs.
+ *
+ * Built by "make microbench" from the simulator sources with -DMICROBENCH,
+ * which leaves out the simulator's main() and the hooked copy of the core,
+ * so get_operand() and the handlers are timed without the cache, which is
+ * timed on its own.
+ */
+
+// Run command format: ./microbench [-n samples] [-k calls] [-c cpu] [kernel prefix]
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sched.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+#include "cache.h"
+#include "pdp11-sim.h"
+
+// Defines
+#define WARMUP_SAMPLES 20
+#define DATA 010000 // operand area, well clear of any code
+
+typedef struct {
+    const char *name;
+    void (*run)(void);
+} kernel_t;
+
+// Kernel state
+static uint16_t next_addr;
+static addr_phrase_t phrase;
+
+// Reset registers so every call sees the same operand addresses
+static inline void reset_regs(void)
+{
+    for (int i = 0; i < 7; i++) reg[i] = DATA + 16 * i;
+    reg[7] = 0;
+}
+
+// Loop and call overhead, subtract from the other kernels
+static void k_overhead(void) { reset_regs(); }
+
+// Cache model
+static void k_cache_hit(void) { reset_regs(); cache_access(DATA, MODE_READ); }
+static void k_cache_write(void) { reset_regs(); cache_access(DATA, MODE_WRITE); }
+static void k_cache_miss(void)
+{
+    // 4 KiB stride walks one set, so every access misses the 4-way cache
+    reset_regs();
+    next_addr += 4096;
+    cache_access(next_addr, MODE_READ);
+}
+
+// Operand fetch, one kernel per addressing mode (register 2, index word 0)
+#define OPERAND_KERNEL(m) \
+    static void k_operand_##m(void) \
+    { \
+        reset_regs(); \
+        phrase.mode = m; \
+        phrase.reg = 2; \
+        get_operand(&phrase); \
+    }
+OPERAND_KERNEL(0)
+OPERAND_KERNEL(1)
+OPERAND_KERNEL(2)
+OPERAND_KERNEL(3)
+OPERAND_KERNEL(4)
+OPERAND_KERNEL(5)
+OPERAND_KERNEL(6)
+OPERAND_KERNEL(7)
+
+// Immediate operand, mode 2 on the PC
+static void k_operand_imm(void)
+{
+    reset_regs();
+    phrase.mode = 2;
+    phrase.reg = 7;
+    get_operand(&phrase);
+}
+
+// Dispatch and handlers; register operands so only the handler is timed
+static void k_operate_halt(void) { reset_regs(); operate(0000000); }
+static void k_operate_mov(void) { reset_regs(); operate(0010102); }
+static void k_mov(void) { reset_regs(); mov(0010102); }
+static void k_cmp(void) { reset_regs(); cmp(0020102); }
+static void k_add(void) { reset_regs(); add(0060102); }
+static void k_sub(void) { reset_regs(); sub(0160102); }
+static void k_asr(void) { reset_regs(); asr(0006202); }
+static void k_asl(void) { reset_regs(); asl(0006302); }
+static void k_br(void) { reset_regs(); br(0000401); }
+static void k_bne(void) { reset_regs(); z = false; bne(0001001); }
+static void k_beq(void) { reset_regs(); z = false; beq(0001401); }
+static void k_sob(void) { reset_regs(); sob(0077201); }
+static void k_halt(void) { reset_regs(); halt(0000000); }
+
+static const kernel_t kernels[] = {
+    {"overhead", k_overhead},
+    {"cache_access/hit", k_cache_hit},
+    {"cache_access/write", k_cache_write},
+    {"cache_access/miss", k_cache_miss},
+    {"get_operand/mode0", k_operand_0},
+    {"get_operand/mode1", k_operand_1},
+    {"get_operand/mode2", k_operand_2},
+    {"get_operand/mode3", k_operand_3},
+    {"get_operand/mode4", k_operand_4},
+    {"get_operand/mode5", k_operand_5},
+    {"get_operand/mode6", k_operand_6},
+    {"get_operand/mode7", k_operand_7},
+    {"get_operand/immediate", k_operand_imm},
+    {"operate/halt", k_operate_halt},
+    {"operate/mov", k_operate_mov},
+    {"handler/mov", k_mov},
+    {"handler/cmp", k_cmp},
+    {"handler/add", k_add},
+    {"handler/sub", k_sub},
+    {"handler/asr", k_asr},
+    {"handler/asl", k_asl},
+    {"handler/br", k_br},
+    {"handler/bne", k_bne},
+    {"handler/beq", k_beq},
+    {"handler/sob", k_sob},
+    {"handler/halt", k_halt},
+};
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+static inline uint64_t now_ticks(void)
+{
+#if HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static int by_value(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Percentile of a sorted sample array
+static double percentile(const double *sorted, int count, double p)
+{
+    int i = (int)(p * (count - 1) + 0.5);
+    return sorted[i];
+}
+
+// Take samples of calls invocations each, returning per-call ns and ticks
+static void measure(const kernel_t *k, int samples, int calls, double *ns, double *ticks)
+{
+    for (int s = -WARMUP_SAMPLES; s < samples; s++)
+    {
+        uint64_t t0 = now_ns(), c0 = now_ticks();
+        for (int i = 0; i < calls; i++) k->run();
+        uint64_t c1 = now_ticks(), t1 = now_ns();
+
+        if (s < 0) continue;
+        ns[s] = (double)(t1 - t0) / calls;
+        ticks[s] = (double)(c1 - c0) / calls;
+    }
+    qsort(ns, samples, sizeof(double), by_value);
+    qsort(ticks, samples, sizeof(double), by_value);
+}
+
+int main(int argc, char *argv[])
+{
+    int samples = 200;
+    int calls = 10000;
+    int cpu = 0;
+    const char *filter = NULL;
+
+    // Check for flags
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) samples = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) calls = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) cpu = atoi(argv[++i]);
+        else if (argv[i][0] != '-') filter = argv[i];
+        else
+        {
+            printf("Invalid flag: %s\n", argv[i]);
+            exit(1);
+        }
+    }
+    if (samples < 1 || calls < 1)
+    {
+        printf("samples and calls must be positive\n");
+        exit(1);
+    }
+
+    // Pin to one core; carry on unpinned if that is not allowed
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0)
+    {
+        printf("warning: could not pin to cpu %d, running unpinned\n", cpu);
+    }
+
+    // Machine state the kernels run against
+    memset(memory, 0, MEMSIZE * sizeof(memory[0]));
+    for (int i = DATA; i < DATA + 0200; i += 2) memory[i] = DATA + 040;
+    cache_init();
+    running = true;
+    trace = verbose = false;
+
+    double *ns = malloc(samples * sizeof(double));
+    double *ticks = malloc(samples * sizeof(double));
+
+    printf("microbenchmarks: %d samples x %d calls, cpu %d\n", samples, calls, cpu);
+    printf("%-24s %9s %9s %9s %9s %9s %11s\n",
+           "kernel", "min", "p10", "median", "p90", "p99", "ticks/call");
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+    {
+        if (filter != NULL && strncmp(kernels[k].name, filter, strlen(filter)) != 0) continue;
+
+        measure(&kernels[k], samples, calls, ns, ticks);
+        printf("%-24s %9.2f %9.2f %9.2f %9.2f %9.2f %11.1f\n", kernels[k].name,
+               ns[0], percentile(ns, samples, 0.10), percentile(ns, samples, 0.50),
+               percentile(ns, samples, 0.90), percentile(ns, samples, 0.99),
+               HAVE_TSC ? percentile(ticks, samples, 0.50) : 0.0);
+    }
+    printf("(times in ns per call, overhead row included in every kernel)\n");
+
+    free(ns);
+    free(ticks);
+    return 0;
+}
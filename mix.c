@@ -0,0 +1,147 @@
+/* instruction mix histograms
+ *
+ * counts executions by opcode and by (source mode, destination mode)
+ *   pair, and attributes to each cell the data words read and written
+ *   and the cache misses of the instructions that landed in it
+ *
+ * routines
+ *
+ *   void mix_init( void );
+ *   void mix_inst( int op, uint16_t instruction, unsigned int reads,
+ *                  unsigned int writes, unsigned int inst_misses );
+ *   void mix_stats( void );
+ *   void mix_export( const char *csv );
+ *
+ * mix_inst() is called by the instrumented main loop after each
+ *   instruction with its decoded opcode, the instruction word, and the
+ *   change in data reads, data writes and cache misses it caused
+ *
+ * mode matrix layout
+ *
+ *   row = source mode 0-7, column = destination mode 0-7 for the double
+ *   operand instructions (mov, cmp, add, sub); row 8 ("-") holds the
+ *   single operand instructions (asr, asl), which have only a
+ *   destination; branches, sob, and halt have no operands and are
+ *   counted in the opcode table only
+ */
+
+#include <string.h>
+
+#include "pdp11-sim.h"
+#include "mix.h"
+
+#define NO_SRC 8 /* matrix row for single operand instructions */
+
+typedef struct {
+  uint64_t execs, reads, writes, misses;
+} mix_cell_t;
+
+static mix_cell_t
+  by_op[NUM_OPS],       /* per-opcode counts     */
+  by_mode[NO_SRC+1][8]; /* per-mode-pair counts  */
+
+static void count( mix_cell_t *cell, unsigned int reads,
+                   unsigned int writes, unsigned int inst_misses ){
+  cell->execs++;
+  cell->reads += reads;
+  cell->writes += writes;
+  cell->misses += inst_misses;
+}
+
+void mix_init( void ){
+  memset( by_op, 0, sizeof( by_op ) );
+  memset( by_mode, 0, sizeof( by_mode ) );
+}
+
+void mix_inst( int op, uint16_t instruction, unsigned int reads,
+               unsigned int writes, unsigned int inst_misses ){
+  int dst_mode = (instruction & 0x0038) >> 3;
+
+  count( &by_op[op], reads, writes, inst_misses );
+
+  switch( op ){
+    case OP_MOV: case OP_CMP: case OP_ADD: case OP_SUB:
+      count( &by_mode[(instruction & 0x0E00) >> 9][dst_mode], reads, writes, inst_misses );
+      break;
+    case OP_ASR: case OP_ASL:
+      count( &by_mode[NO_SRC][dst_mode], reads, writes, inst_misses );
+      break;
+  }
+}
+
+void mix_stats( void ){
+  uint64_t total = 0;
+  int op, s, d;
+
+  for( op=0; op<NUM_OPS; op++ ) total += by_op[op].execs;
+
+  printf( "instruction mix (in decimal):\n" );
+  printf( "  opcode       execs      %%    reads   writes   misses\n" );
+  for( op=0; op<NUM_OPS; op++ ){
+    if( by_op[op].execs == 0 ) continue;
+    printf( "  %-7s %10llu %5.1f%% %8llu %8llu %8llu\n", op_names[op],
+            (unsigned long long)by_op[op].execs,
+            total ? 100.0 * by_op[op].execs / total : 0.0,
+            (unsigned long long)by_op[op].reads,
+            (unsigned long long)by_op[op].writes,
+            (unsigned long long)by_op[op].misses );
+  }
+
+  printf( "addressing mode executions (row = src mode, column = dst mode):\n" );
+  printf( "    " );
+  for( d=0; d<8; d++ ) printf( " %9d", d );
+  printf( "\n" );
+  for( s=0; s<=NO_SRC; s++ ){
+    if( s == NO_SRC ) printf( "   -" );
+    else printf( "   %d", s );
+    for( d=0; d<8; d++ ) printf( " %9llu", (unsigned long long)by_mode[s][d].execs );
+    printf( "\n" );
+  }
+
+  printf( "addressing mode memory traffic (nonzero cells):\n" );
+  printf( "  src dst       execs    reads   writes   misses\n" );
+  for( s=0; s<=NO_SRC; s++ ){
+    for( d=0; d<8; d++ ){
+      mix_cell_t *cell = &by_mode[s][d];
+      if( cell->execs == 0 ) continue;
+      if( s == NO_SRC ) printf( "    - " );
+      else printf( "    %d ", s );
+      printf( "  %d  %10llu %8llu %8llu %8llu\n", d,
+              (unsigned long long)cell->execs, (unsigned long long)cell->reads,
+              (unsigned long long)cell->writes, (unsigned long long)cell->misses );
+    }
+  }
+}
+
+/* one row per nonzero cell; kind is "opcode" or "modes", src is empty
+ *   for single operand rows, and fields not used by a kind are empty */
+
+void mix_export( const char *csv ){
+  FILE *fp;
+  int op, s, d;
+
+  fp = fopen( csv, "w" );
+  if( fp == NULL ){
+    printf( "cannot write instruction mix to %s\n", csv );
+    return;
+  }
+  fprintf( fp, "kind,opcode,src_mode,dst_mode,executions,data_reads,data_writes,cache_misses\n" );
+  for( op=0; op<NUM_OPS; op++ ){
+    if( by_op[op].execs == 0 ) continue;
+    fprintf( fp, "opcode,%s,,,%llu,%llu,%llu,%llu\n", op_names[op],
+             (unsigned long long)by_op[op].execs, (unsigned long long)by_op[op].reads,
+             (unsigned long long)by_op[op].writes, (unsigned long long)by_op[op].misses );
+  }
+  for( s=0; s<=NO_SRC; s++ ){
+    for( d=0; d<8; d++ ){
+      mix_cell_t *cell = &by_mode[s][d];
+      if( cell->execs == 0 ) continue;
+      if( s == NO_SRC ) fprintf( fp, "modes,,," );
+      else fprintf( fp, "modes,,%d,", s );
+      fprintf( fp, "%d,%llu,%llu,%llu,%llu\n", d,
+               (unsigned long long)cell->execs, (unsigned long long)cell->reads,
+               (unsigned long long)cell->writes, (unsigned long long)cell->misses );
+    }
+  }
+  fclose( fp );
+}
@@ -0,0 +1,12 @@
+#ifndef MIX_H
+#define MIX_H
+
+#include <stdint.h>
+
+void mix_init( void );
+void mix_inst( int op, uint16_t instruction, unsigned int reads,
+               unsigned int writes, unsigned int inst_misses );
+void mix_stats( void );
+void mix_export( const char *csv );
+
+#endif
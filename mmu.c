@@ -0,0 +1,260 @@
+/* KT11 memory management unit
+ *
+ * maps the 16-bit virtual address space of the current mode (kernel or
+ *   user, from PSW bits 15-14) onto up to 4 MiB of physical memory in
+ *   eight 8 KiB pages, each with a page address register (PAR, base in
+ *   64-byte blocks) and a page descriptor register (PDR: length in
+ *   blocks, expansion direction, access control, written bit)
+ *
+ * routines
+ *
+ *   bool mmu_init( const char *spec );
+ *   void mmu_ckpt( void );
+ *   uint16_t mmu_read_slow( uint16_t address );
+ *   void mmu_write_slow( uint16_t address, uint16_t value );
+ *   bool mmu_peek( uint16_t address, uint16_t *value );
+ *   void mmu_stats( void );
+ *
+ * spec is the physical memory size in KiB (64 to MMU_MAX_KB); mmu_init()
+ *   replaces memory[] with a physical memory of that size, puts the
+ *   MMU registers on the I/O page, and starts with translation on,
+ *   22-bit mapping, and both modes mapped 1:1 onto the low 56 KiB with
+ *   page 7 on the I/O page, so existing programs run unchanged
+ *
+ * registers
+ *
+ *   172300-172316  kernel PDR 0-7     177600-177616  user PDR 0-7
+ *   172340-172356  kernel PAR 0-7     177640-177656  user PAR 0-7
+ *   177572         MMR0 (bit 0 enables translation, 15-13 abort cause)
+ *   177574-177576  MMR1, MMR2 (read only, not maintained)
+ *   172516         MMR3 (bit 4 selects 22-bit mapping, else 18-bit)
+ *
+ * translation cache
+ *
+ *   direct-mapped on the 64-byte virtual block number, one table for
+ *   reads and one for writes; an entry holds the mode and block as its
+ *   tag and the physical minus virtual address, so a hit is one compare
+ *   and one add (mmu_read() and mmu_write() in mmu.h); the slow path
+ *   does the full length and access checks and fills the entry, and a
+ *   write to any MMU register empties both tables
+ *
+ *   blocks that map to the I/O page are never cached, and a page is
+ *   only entered in the write table once its written bit is set
+ *
+ * a failed check (non-resident, read-only, or beyond the page length)
+ *   records the cause in MMR0 and stops the simulator, since there are
+ *   no traps yet; so does a reference to nonexistent physical memory
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unibus.h"
+#include "mmu.h"
+#include "ckpt.h"
+
+#define KERNEL 0
+#define USER 1
+
+static uint16_t
+  par[2][8],  /* page address registers, kernel and user */
+  pdr[2][8],  /* page descriptor registers */
+  mmr0,
+  mmr3;
+
+static uint32_t phys_bytes;  /* physical memory size */
+
+bool
+  mmu_present = false,  /* configured with mmu_init() */
+  mmu_on = false;       /* MMR0 bit 0 */
+uint64_t
+  tlb_hits = 0,    /* counter */
+  tlb_misses = 0;  /* counter */
+tlb_entry_t tlb_read[MMU_TLB_SIZE], tlb_write[MMU_TLB_SIZE];
+
+static void tlb_flush( void ){
+  int i;
+  for( i=0; i<MMU_TLB_SIZE; i++ ) tlb_read[i].tag = tlb_write[i].tag = 0xFFFFFFFF;
+}
+
+/* physical address of the I/O page */
+static uint32_t io_base( void ){
+  return (mmr3 & 020) ? 017760000 : 0760000;
+}
+
+static uint16_t *mmu_register( uint16_t address ){
+  if( address >= 0172300 && address <= 0172316 ) return &pdr[KERNEL][(address >> 1) & 7];
+  if( address >= 0172340 && address <= 0172356 ) return &par[KERNEL][(address >> 1) & 7];
+  if( address >= 0177600 && address <= 0177616 ) return &pdr[USER][(address >> 1) & 7];
+  if( address >= 0177640 && address <= 0177656 ) return &par[USER][(address >> 1) & 7];
+  if( address == 0177572 ) return &mmr0;
+  if( address == 0172516 ) return &mmr3;
+  return NULL;
+}
+
+static uint16_t register_read( uint16_t address ){
+  uint16_t *r = mmu_register( address );
+  return r ? *r : 0;
+}
+
+static void register_write( uint16_t address, uint16_t value ){
+  uint16_t *r = mmu_register( address );
+  if( r == NULL ) return;
+  if( r == &pdr[KERNEL][(address >> 1) & 7] || r == &pdr[USER][(address >> 1) & 7] ){
+    value &= 077417;  /* length, direction, access; writing clears W */
+  }
+  *r = value;
+  mmu_on = mmr0 & 1;
+  tlb_flush();
+}
+
+/* registers and translation cache, for checkpoints */
+void mmu_ckpt( void ){
+  ckpt_region( par, sizeof( par ) );
+  ckpt_region( pdr, sizeof( pdr ) );
+  ckpt_region( &mmr0, sizeof( mmr0 ) );
+  ckpt_region( &mmr3, sizeof( mmr3 ) );
+  ckpt_region( &mmu_on, sizeof( mmu_on ) );
+  ckpt_region( tlb_read, sizeof( tlb_read ) );
+  ckpt_region( tlb_write, sizeof( tlb_write ) );
+  ckpt_region( &tlb_hits, sizeof( tlb_hits ) );
+  ckpt_region( &tlb_misses, sizeof( tlb_misses ) );
+}
+
+bool mmu_init( const char *spec ){
+  char *end;
+  long kb = strtol( spec, &end, 10 );
+  int m, i;
+
+  if( *end != '\0' || kb < 64 || kb > MMU_MAX_KB ) return false;
+  phys_bytes = kb * 1024;
+  memory = calloc( phys_bytes, sizeof( memory[0] ) );
+  if( memory == NULL ) return false;
+  memory_words = phys_bytes;
+
+  unibus_register( 0172300, 8, register_read, register_write );
+  unibus_register( 0172340, 8, register_read, register_write );
+  unibus_register( 0177600, 8, register_read, register_write );
+  unibus_register( 0177640, 8, register_read, register_write );
+  unibus_register( 0177572, 3, register_read, register_write );
+  unibus_register( 0172516, 1, register_read, register_write );
+
+  for( m=KERNEL; m<=USER; m++ ){
+    for( i=0; i<7; i++ ){
+      par[m][i] = i * 0200;
+      pdr[m][i] = 077406;  /* full length, read/write */
+    }
+    par[m][7] = 0177600;
+    pdr[m][7] = 077406;
+  }
+  mmr3 = 020;
+  mmr0 = 1;
+  mmu_present = mmu_on = true;
+  tlb_flush();
+  return true;
+}
+
+static void mmu_abort( uint16_t address, uint16_t cause, const char *why ){
+  mmr0 |= cause | ((psw_high >> 9) & 0140) | ((address >> 12) & 016);
+  printf( "MMU abort (%s) at %06o (PC %06o)\n", why, address, inst_pc );
+  exit( 1 );
+}
+
+/* the physical address of a reference in *pa, or the MMR0 abort cause
+ *   and its name in *why */
+static uint16_t map( uint16_t address, bool write, uint32_t *pa, const char **why ){
+  int mode = (psw_high >> 14) == 3 ? USER : KERNEL,
+      page = address >> 13,
+      block = (address >> 6) & 0177;
+  uint16_t d = pdr[mode][page];
+  int length = (d >> 8) & 0177,
+      access = d & 7;
+
+  if( access == 0 || access == 3 || access == 7 ){
+    *why = "non-resident";
+    return 0100000;
+  }
+  if( write && access < 4 ){
+    *why = "read-only";
+    return 0020000;
+  }
+  if( (d & 010) ? block < length : block > length ){
+    *why = "page length";
+    return 0040000;
+  }
+  *pa = ((uint32_t)par[mode][page] << 6) + (address & 017777);
+  if( !(mmr3 & 020) ) *pa &= 0777777;
+  return 0;
+}
+
+static uint32_t translate( uint16_t address, bool write ){
+  const char *why;
+  uint32_t pa;
+  uint16_t cause = map( address, write, &pa, &why );
+
+  if( cause ) mmu_abort( address, cause, why );
+  if( write ) pdr[(psw_high >> 14) == 3 ? USER : KERNEL][address >> 13] |= 0100;
+  return pa;
+}
+
+static bool physical_ram( uint16_t address, uint32_t pa ){
+  if( pa >= io_base() ) return false;
+  if( pa >= phys_bytes ){
+    printf( "Nonexistent memory at %08o (virtual %06o, PC %06o)\n", pa, address, inst_pc );
+    exit( 1 );
+  }
+  return true;
+}
+
+uint16_t mmu_read_slow( uint16_t address ){
+  uint32_t pa = translate( address, false );
+  tlb_entry_t *e;
+
+  tlb_misses++;
+  if( !physical_ram( address, pa ) ) return unibus_read( IOPAGE + (pa - io_base()) );
+  e = &tlb_read[(address >> 6) & (MMU_TLB_SIZE - 1)];
+  e->tag = tlb_key( address );
+  e->delta = (int32_t)pa - address;
+  return memory[pa];
+}
+
+void mmu_write_slow( uint16_t address, uint16_t value ){
+  uint32_t pa = translate( address, true );
+  tlb_entry_t *e;
+
+  tlb_misses++;
+  if( !physical_ram( address, pa ) ){
+    unibus_write( IOPAGE + (pa - io_base()), value );
+    return;
+  }
+  e = &tlb_write[(address >> 6) & (MMU_TLB_SIZE - 1)];
+  e->tag = tlb_key( address );
+  e->delta = (int32_t)pa - address;
+  memory[pa] = value;
+  mark_dirty( pa );
+}
+
+/* the word a read would see, without counting, setting bits, filling
+ *   the translation cache or aborting; false if the read would abort */
+bool mmu_peek( uint16_t address, uint16_t *value ){
+  const char *why;
+  uint32_t pa;
+
+  if( map( address, false, &pa, &why ) ) return false;
+  if( pa >= io_base() ) return unibus_peek( IOPAGE + (pa - io_base()), value );
+  if( pa >= phys_bytes ) return false;
+  *value = memory[pa];
+  return true;
+}
+
+void mmu_stats( void ){
+  uint64_t total = tlb_hits + tlb_misses;
+  printf( "mmu statistics (in decimal):\n" );
+  printf( "  physical memory   = %u KiB, %d-bit mapping, translation %s\n",
+          phys_bytes / 1024, (mmr3 & 020) ? 22 : 18, mmu_on ? "on" : "off" );
+  printf( "  translations      = %llu\n", (unsigned long long)total );
+  printf( "  tlb hits          = %llu\n", (unsigned long long)tlb_hits );
+  printf( "  tlb misses        = %llu\n", (unsigned long long)tlb_misses );
+  if( total ) printf( "  tlb hit rate      = %.2f%%\n", 100.0 * tlb_hits / total );
+}
@@ -0,0 +1,56 @@
+#ifndef MMU_H
+#define MMU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "pdp11-sim.h"
+
+#define MMU_TLB_SIZE 64    /* translation cache entries, power of 2 */
+#define MMU_MAX_KB 4096    /* 22-bit physical address space */
+
+typedef struct {
+  uint32_t tag;    /* mode << 10 | virtual block number */
+  int32_t delta;   /* physical - virtual address */
+} tlb_entry_t;
+
+extern bool mmu_present, mmu_on;
+extern uint64_t tlb_hits, tlb_misses;
+extern tlb_entry_t tlb_read[MMU_TLB_SIZE], tlb_write[MMU_TLB_SIZE];
+
+bool mmu_init( const char *spec );
+void mmu_ckpt( void );
+uint16_t mmu_read_slow( uint16_t address );
+void mmu_write_slow( uint16_t address, uint16_t value );
+bool mmu_peek( uint16_t address, uint16_t *value );
+void mmu_stats( void );
+
+/* translation cache lookup key for the current processor mode */
+static inline uint32_t tlb_key( uint16_t address ){
+  return ((uint32_t)(psw_high >> 14) << 10) | (address >> 6);
+}
+
+/* translated references: one compare and one add when the block is in
+ *   the translation cache */
+
+static inline uint16_t mmu_read( uint16_t address ){
+  tlb_entry_t *e = &tlb_read[(address >> 6) & (MMU_TLB_SIZE - 1)];
+  if( e->tag == tlb_key( address ) ){
+    tlb_hits++;
+    return memory[address + e->delta];
+  }
+  return mmu_read_slow( address );
+}
+
+static inline void mmu_write( uint16_t address, uint16_t value ){
+  tlb_entry_t *e = &tlb_write[(address >> 6) & (MMU_TLB_SIZE - 1)];
+  if( e->tag == tlb_key( address ) ){
+    tlb_hits++;
+    memory[address + e->delta] = value;
+    mark_dirty( address + e->delta );
+  }else{
+    mmu_write_slow( address, value );
+  }
+}
+
+#endif
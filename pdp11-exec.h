@@ -0,0 +1,1021 @@
+// Execution core of the PDP-11 simulator, included twice by pdp11-sim.c:
+// once with HOOKED 0 for the public operate(), get_operand(), ... used
+// when nothing watches the reference stream, and once with HOOKED 1 for
+// static *_hooked copies that report every fetch, data access and branch
+// to the callbacks registered in hooks.c. main() picks the loop variant
+// once, so the plain core has no per-access test at all.
+//
+// Not include-guarded on purpose.
+
+#if HOOKED
+#define EXEC(name) name##_hooked
+#define STATIC static
+#else
+#define EXEC(name) name
+#define STATIC
+#endif
+
+// Function prototypes for this variant
+STATIC void EXEC(operate)(uint16_t instruction);
+STATIC void EXEC(get_operand)(addr_phrase_t *phrase);
+STATIC void EXEC(update_operand)(addr_phrase_t *phrase);
+STATIC void EXEC(put_operand)(addr_phrase_t *phrase);
+STATIC void EXEC(add)(uint16_t operand);
+STATIC void EXEC(asl)(uint16_t operand);
+STATIC void EXEC(asr)(uint16_t operand);
+STATIC void EXEC(beq)(uint16_t operand);
+STATIC void EXEC(bne)(uint16_t operand);
+STATIC void EXEC(br)(uint16_t operand);
+STATIC void EXEC(cmp)(uint16_t operand);
+STATIC void EXEC(halt)(uint16_t operand);
+STATIC void EXEC(mov)(uint16_t operand);
+STATIC void EXEC(rti)(uint16_t operand);
+STATIC void EXEC(sob)(uint16_t operand);
+STATIC void EXEC(sub)(uint16_t operand);
+STATIC void EXEC(wait_inst)(uint16_t operand);
+
+// Memory references and branches: every instruction fetch, data access
+// and branch outcome goes through these; without hooks they are empty
+static inline void EXEC(fetch_access)(uint16_t addr)
+{
+#if HOOKED
+    call_fetch_hooks(inst_pc, addr);
+#endif
+}
+
+static inline void EXEC(data_access)(uint16_t addr, bool type)
+{
+#if HOOKED
+    if (type == MODE_WRITE) call_write_hooks(inst_pc, addr);
+    else call_read_hooks(inst_pc, addr);
+#endif
+}
+
+static inline void EXEC(branch_event)(uint16_t pc, uint16_t target, bool taken)
+{
+#if HOOKED
+    call_branch_hooks(pc, target, taken);
+#endif
+}
+
+STATIC void EXEC(operate)(uint16_t instruction) {
+
+    // Execute the decoded opcode
+    switch(decode(instruction))
+    {
+        case OP_MOV: EXEC(mov)(instruction); break;
+        case OP_CMP: EXEC(cmp)(instruction); break;
+        case OP_ADD: EXEC(add)(instruction); break;
+        case OP_SUB: EXEC(sub)(instruction); break;
+        case OP_SOB: EXEC(sob)(instruction); break;
+        case OP_BR: EXEC(br)(instruction); break;
+        case OP_BNE: EXEC(bne)(instruction); break;
+        case OP_BEQ: EXEC(beq)(instruction); break;
+        case OP_ASR: EXEC(asr)(instruction); break;
+        case OP_ASL: EXEC(asl)(instruction); break;
+        case OP_HALT: EXEC(halt)(instruction); break;
+        case OP_WAIT: EXEC(wait_inst)(instruction); break;
+        case OP_RTI: EXEC(rti)(instruction); break;
+
+        // Invalid opcode
+        default:
+            printf("Invalid opcode: %d\n", instruction);
+            exit(1);
+    }
+
+    // Increment instruction execution count
+    inst_execs++;
+
+    // Increment instruction fetch count
+    inst_fetches++;
+}
+
+STATIC void EXEC(get_operand)( addr_phrase_t *phrase) {
+    #ifdef DEBUG
+    printf("get_operand: mode = %d, reg = %d\n", phrase->mode, phrase->reg);
+    #endif
+
+    assert( (phrase->mode >= 0) && (phrase->mode <= 7) );
+    assert( (phrase->reg >= 0) && (phrase->reg <= 7) );
+    
+    // Decide register mode
+    switch( phrase->mode ) {
+
+        /* register */
+        case 0:
+            phrase->value = reg[phrase->reg];
+            break;
+
+        /* register indirect */
+        case 1:
+            phrase->addr = reg[phrase->reg ];  /* address is in the register */
+            assert( phrase->addr < MEMSIZE );
+
+            phrase->value = bus_read(phrase->addr);  /* value is in memory */
+            memory_reads++;
+            // cache_access(phrase->addr, MODE_READ);
+            assert( phrase->value < 0200000 );
+
+            #ifdef DEBUG
+            printf("get_operand: addr: %07o, value: %07o\n", phrase->addr, phrase->value);
+            #endif
+            break;
+
+        /* autoincrement (post reference) */
+        case 2:
+            // Update PC mode
+            if( phrase->reg == 7 ) { // Immediate mode
+                #ifdef DEBUG
+                printf("get_operand: immediate mode\n");
+                #endif
+
+                // Operand is in the next word in memory
+                phrase->addr = reg[phrase->reg];
+                inst_fetches++;
+                // cache_access(phrase->addr, MODE_READ);
+                reg[7] += 2;
+                assert( phrase->value < 0200000 );
+            }
+            // Update register mode
+            else {
+                phrase->addr = reg[phrase->reg];  /* address is in the register */
+                assert( phrase->addr < MEMSIZE );
+                reg[phrase->reg] += 2;  /* increment the register */
+            }
+
+            phrase->value = bus_read(phrase->addr);  /* value is in memory */
+            EXEC(data_access)(phrase->addr, MODE_READ);
+
+            #ifdef DEBUG
+            printf("get_operand: addr: %07o, value: %07o\n", phrase->addr, phrase->value);
+            #endif
+            break;
+
+        /* autoincrement indirect */
+        case 3:
+            // Update PC mode
+            if( phrase->reg == 7 ) { // Absolute mode
+                #ifdef DEBUG
+                printf("get_operand: absolute mode\n");
+                #endif
+
+                // The address of the operand is in the next word
+                phrase->addr = bus_read(reg[7]);
+                // cache_access(reg[7], MODE_READ);
+                inst_fetches++;
+                assert( phrase->addr < MEMSIZE );
+
+                memory_reads++;
+            }
+
+            // Update register mode
+            else {
+                phrase->addr = reg[phrase->reg];  /* address is in the register */
+                assert( phrase->addr < MEMSIZE );
+                phrase->addr = bus_read(phrase->addr);  /* address is in memory */
+                // cache_access(phrase->addr, MODE_READ);
+                assert( phrase->addr < MEMSIZE );
+
+                memory_reads += 2;
+            }
+
+            // The value of the operand is in memory
+            phrase->value = bus_read(phrase->addr);
+            assert( phrase->value < 0200000 );
+            EXEC(data_access)(phrase->addr, MODE_READ);
+
+            // Increment the register
+            reg[phrase->reg] += 2;
+
+            #ifdef DEBUG
+            printf("get_operand: addr: %07o, value: %07o\n", phrase->addr, phrase->value);
+            #endif
+            break;
+
+        /* autodecrement */
+        case 4:
+            reg[phrase->reg] -= 2;  /* decrement the register */
+            phrase->addr = reg[phrase->reg];  /* address is in the register */
+            assert( phrase->addr < MEMSIZE );
+
+            phrase->value = bus_read(phrase->addr);  /* value is in memory */
+            EXEC(data_access)(phrase->addr, MODE_READ);
+            memory_reads++;
+            assert( phrase->value < 0200000 );
+            break;
+
+        /* autodecrement indirect */
+        case 5:
+            reg[phrase->reg] -= 2;  /* decrement the register */
+            phrase->addr = reg[phrase->reg];  /* address is in the register */
+            assert( phrase->addr < MEMSIZE );
+            phrase->addr = bus_read(phrase->addr);  /* address is in memory */
+            EXEC(data_access)(phrase->addr, MODE_READ);
+            memory_reads++;
+            assert( phrase->addr < MEMSIZE );
+            
+            phrase->value = bus_read(phrase->addr);  /* value is in memory */
+            EXEC(data_access)(phrase->addr, MODE_READ);
+            memory_reads++;
+
+            #ifdef DEBUG
+            printf("get_operand: addr: %07o, value: %07o\n", phrase->addr, phrase->value);
+            #endif
+            break;
+
+        /* index */
+        case 6:
+            // Update PC mode
+            if( phrase->reg == 7 ) { // Relative mode
+                // The address of the operand is in the next word of the instruction added to the PC
+                phrase->addr = (bus_read(reg[7]) + reg[7]) & 0177777;
+                //cache_access(reg[7], MODE_READ);
+                inst_fetches++;
+                reg[7] += 2;
+                assert( phrase->addr < MEMSIZE );
+            }
+
+            // Update register mode
+            else {
+                phrase->addr = (bus_read(reg[7]) + reg[phrase->reg]) & 0177777;
+                //cache_access(reg[7], MODE_READ);
+                inst_fetches++;
+                reg[7] += 2;
+                assert( phrase->addr < MEMSIZE );
+            }
+
+            // Get value from memory
+            phrase->value = bus_read(phrase->addr);
+            EXEC(data_access)(phrase->addr, MODE_READ);
+            memory_reads += 2;
+            assert( phrase->value < 0200000 );
+
+            #ifdef DEBUG
+            printf("get_operand: addr: %07o, value: %07o\n", phrase->addr, phrase->value);
+            #endif
+            break;
+
+        /* index indirect */
+        case 7:
+            // Update PC mode
+            if( phrase->reg == 7 ) { // Relative deferred mode
+                // The address of the address of the operand is the next word of the instruction added to reg[7]
+                phrase->addr = (bus_read(reg[7]) + reg[7]) & 0177777;
+                // cache_access(reg[7], MODE_READ);
+                inst_fetches++;
+                assert( phrase->addr < MEMSIZE );
+            }
+
+            // Update register mode
+            else {
+                phrase->addr = (bus_read(reg[7]) + reg[phrase->reg]) & 0177777;
+                // cache_access(reg[7], MODE_READ);
+                inst_fetches++;
+                assert( phrase->addr < MEMSIZE );
+            }
+            reg[7] += 2;
+
+            // Get value from memory
+            EXEC(data_access)(phrase->addr, MODE_READ);
+            phrase->addr = bus_read(phrase->addr);
+            assert( phrase->addr < MEMSIZE );
+            phrase->value = bus_read(phrase->addr);
+            EXEC(data_access)(phrase->addr, MODE_READ);
+            memory_reads += 2;
+            assert( phrase->value < 0200000 );
+
+            #ifdef DEBUG
+            printf("get_operand: addr: %07o, value: %07o\n", phrase->addr, phrase->value);
+            #endif
+            break;
+
+        default:
+            printf("unimplemented address mode %o\n", phrase->mode);
+            exit(1);
+    }
+}
+
+STATIC void EXEC(update_operand)(addr_phrase_t *phrase) {
+    assert( (phrase->mode >= 0) && (phrase->mode <= 7) );
+    assert( (phrase->reg >= 0) && (phrase->reg <= 7) );
+
+    // Decide register mode
+    switch( phrase->mode ) {
+
+        /* register */
+        case 0:
+            reg[phrase->reg] = phrase->value;
+            break;
+
+        /* register indirect */
+        case 1:
+            bus_write(phrase->addr, phrase->value);
+            EXEC(data_access)(phrase->addr, MODE_WRITE);
+            memory_writes++;
+            break;
+
+        /* autoincrement (post reference) */
+        case 2:
+            // Update PC mode
+            if( phrase->reg == 7 ) { // Immediate mode
+                // Immediate mode has no address
+                // Do nothing
+            }
+            // Update register mode
+            else {
+                bus_write(phrase->addr, phrase->value);
+                EXEC(data_access)(phrase->addr, MODE_WRITE);
+                memory_writes++;
+            }
+            break;
+
+        /* autoincrement indirect */
+        case 3:
+            // Get value from memory
+            bus_write(phrase->addr, phrase->value);
+            EXEC(data_access)(phrase->addr, MODE_WRITE);
+            memory_writes++;
+            break;
+
+        /* autodecrement */
+        case 4:
+            bus_write(phrase->addr, phrase->value);
+            EXEC(data_access)(phrase->addr, MODE_WRITE);
+            memory_writes++;
+            break;
+
+        /* autodecrement indirect */
+        case 5:
+            bus_write(phrase->addr, phrase->value);
+            EXEC(data_access)(phrase->addr, MODE_WRITE);
+            memory_writes++;
+            break;
+
+        /* index */
+        case 6:
+            // Get value from memory
+            bus_write(phrase->addr, phrase->value);
+            EXEC(data_access)(phrase->addr, MODE_WRITE);
+            memory_writes++;
+            break;
+
+        /* index indirect */
+        case 7:
+            // Get value from memory
+            bus_write(phrase->addr, phrase->value);
+            EXEC(data_access)(phrase->addr, MODE_WRITE);
+            memory_writes++;
+            break;
+    }
+}
+
+STATIC void EXEC(put_operand)(addr_phrase_t *phrase) {
+    assert( (phrase->mode >= 0) && (phrase->mode <= 7) );
+    assert( (phrase->reg >= 0) && (phrase->reg <= 7) );
+
+    // Decide register mode
+    switch( phrase->mode ) {
+
+        /* register */
+        case 0:
+            reg[phrase->reg] = phrase->value;
+            break;
+
+        /* register indirect */
+        case 1:
+            bus_write(phrase->addr, phrase->value);
+            EXEC(data_access)(phrase->addr, MODE_WRITE);
+            memory_writes++;
+            break;
+
+        /* autoincrement (post reference) */
+        case 2:
+            // Update PC mode
+            if( phrase->reg == 7 ) { // Immediate mode
+                // Immediate mode has no address
+                // Do nothing
+            }
+            // Update register mode
+            else {
+                bus_write(phrase->addr, phrase->value);
+                EXEC(data_access)(phrase->addr, MODE_WRITE);
+                memory_writes++;
+            }
+            break;
+
+        /* autoincrement indirect */
+        case 3:
+            // Get value from memory
+            bus_write(phrase->addr, phrase->value);
+            EXEC(data_access)(phrase->addr, MODE_WRITE);
+            memory_writes++;
+            break;
+
+        /* autodecrement */
+        case 4:
+            bus_write(phrase->addr, phrase->value);
+            EXEC(data_access)(phrase->addr, MODE_WRITE);
+            memory_writes++;
+            break;
+
+        /* autodecrement indirect */
+        case 5:
+            bus_write(phrase->addr, phrase->value);
+            EXEC(data_access)(phrase->addr, MODE_WRITE);
+            memory_writes++;
+            break;
+
+        /* index */
+        case 6:
+            // Get value from memory
+            bus_write(phrase->addr, phrase->value);
+            EXEC(data_access)(phrase->addr, MODE_WRITE);
+            memory_writes++;
+            break;
+
+        /* index indirect */
+        case 7:
+            // Get value from memory
+            bus_write(phrase->addr, phrase->value);
+            EXEC(data_access)(phrase->addr, MODE_WRITE);
+            memory_writes++;
+            break;
+    }
+}
+
+STATIC void EXEC(add)(uint16_t operand)
+{
+    #ifdef DEBUG
+    printf("----------add: operand = %d----------\n", operand);
+    #endif
+
+    // Get source and destination address phrases
+    src.mode = (operand & 0x0E00) >> 9;
+    src.reg = (operand & 0x01C0) >> 6;
+    dst.mode = (operand & 0x0038) >> 3;
+    dst.reg = (operand & 0x0007);
+
+    // Get source and destination values
+    EXEC(get_operand)(&src);
+    EXEC(get_operand)(&dst);
+
+    // Save old value of destination
+    uint16_t old_dst = dst.value;
+
+    // Add source and destination
+    dst.value = dst.value + src.value;
+
+    // Ensure that the result is 16 bits
+    dst.value = dst.value & 0xFFFF;
+
+    // Write back to memory
+    EXEC(update_operand)(&dst);
+
+    // Set condition codes
+    n = dst.value >> 15;
+    z = (dst.value == 0);
+    v = ((old_dst >> 15) == (src.value >> 15)) && ((dst.value >> 15) != (src.value >> 15));
+    c = (dst.value < old_dst);
+
+    // instruction trace
+    if (trace || verbose)
+    {
+        printf("add instruction sm %o, sr %o dm %o dr %o\n", src.mode, src.reg, dst.mode, dst.reg);
+    }
+
+    // verbose
+    if (verbose) {
+        printf("  src.value = %07o\n  dst.value = %07o\n  result    = %07o\n", src.value, old_dst, dst.value);
+        printf("  nzvc bits = 4'b%d%d%d%d\n", n, z, v, c);
+        
+        // register dump
+        pregs();
+    }
+}
+
+STATIC void EXEC(asl)(uint16_t operand)
+{
+    #ifdef DEBUG
+    printf("----------asl: operand = %d----------\n", operand);
+    #endif
+
+    // Get address phrase
+    dst.mode = (operand & 0x0038) >> 3;
+    dst.reg = (operand & 0x0007);
+    
+    // Get value
+    EXEC(get_operand)(&dst);
+    
+    // Save old value
+    uint16_t old_value = dst.value;
+
+    // Shift left
+    dst.value = dst.value << 1;
+
+    // Clamp to 16 bits
+    dst.value = dst.value & 0xFFFF;
+
+    // Write back to memory
+    EXEC(update_operand)(&dst);
+
+    // Set condition codes
+    n = dst.value & 0x8000;
+    z = dst.value == 0;
+    v = (old_value & 0x8000) != (dst.value & 0x8000);
+    c = (old_value & 0x8000) != 0;
+
+    // instruction trace
+    if (trace || verbose)
+    {
+        printf("asl instruction dm %o dr %o\n", dst.mode, dst.reg);
+    }
+
+    // value dump
+    if (verbose) {
+        printf("  dst.value = %07o\n  result    = %07o\n", old_value, dst.value);
+        printf("  nzvc bits = 4'b%d%d%d%d\n", n, z, v, c);
+        
+        // register dump
+        pregs();
+    }
+}
+
+STATIC void EXEC(asr)(uint16_t operand)
+{
+    #ifdef DEBUG
+    printf("----------asr: operand = %d----------\n", operand);
+    #endif
+
+    // Get address phrase
+    dst.mode = (operand & 0x0038) >> 3;
+    dst.reg = (operand & 0x0007);
+
+    // Get value
+    EXEC(get_operand)(&dst);
+
+    // Save old value
+    uint16_t old_value = dst.value;
+
+    // Copy sign bit
+    uint16_t sign_bit = dst.value & 0x8000;
+
+    // Shift right
+    dst.value = dst.value >> 1;
+
+    // Write sign bit
+    dst.value = dst.value | sign_bit;
+
+    // Ensure that the result is 16 bits
+    dst.value = dst.value & 0xFFFF;
+
+    // Write back to memory
+    EXEC(update_operand)(&dst);
+
+    // Set condition codes
+    n = dst.value & 0x8000;
+    z = dst.value == 0;
+    v = ((old_value & 0x8000) && ((old_value & 0x0001) == 0)) || (!(old_value & 0x8000) && (old_value & 0x0001));
+    c = (old_value & 0x0001) != 0;
+
+    // instruction trace
+    if (trace || verbose)
+    {
+        printf("asr instruction dm %o dr %o\n", dst.mode, dst.reg);
+    }
+
+    // value dump
+    if (verbose) {
+        printf("  dst.value = %07o\n  result    = %07o\n", old_value, dst.value);
+        printf("  nzvc bits = 4'b%d%d%d%d\n", n, z, v, c);
+        
+        // register dump
+        pregs();
+    }
+}
+
+STATIC void EXEC(beq)(uint16_t operand)
+{
+    #ifdef DEBUG
+    printf("----------beq: operand = %d----------\n", operand);
+    #endif
+
+    int offset = operand & 0377;          /* 8-bit signed offset */ 
+
+    offset = (int8_t)offset;     /* sign extend to 32 bits */ 
+
+    #ifdef DEBUG
+    printf("operand: %o, offset: %o\n", operand, offset);
+    #endif
+
+    // Branch site and target for the predictor models
+    uint16_t pc = reg[7] - 2;
+    uint16_t target = (reg[7] + 2 * offset) & 0177777;
+
+    if(z){ 
+        reg[7] = (reg[7] + 2 * offset) & 0177777; 
+        branch_taken++; 
+    }
+
+    branch_execs++;
+    EXEC(branch_event)(pc, target, z);
+
+    // clamp offset for printing
+    offset = offset & 0xFF;
+
+    // instruction trace
+    if (trace || verbose) {
+        printf("beq instruction with offset %04o\n", offset);
+    }
+
+    // value dump
+    if (verbose) {
+        // register dump
+        pregs();
+    }
+}
+
+STATIC void EXEC(bne)(uint16_t operand)
+{
+    #ifdef DEBUG
+    printf("----------bne: operand = %d----------\n", operand);
+    #endif
+
+    int offset = operand & 0377;          /* 8-bit signed offset */ 
+
+    offset = (int8_t)offset;     /* sign extend to 32 bits */ 
+
+    #ifdef DEBUG
+    printf("operand: %o, offset: %o\n", operand, offset);
+    #endif
+
+    // Branch site and target for the predictor models
+    uint16_t pc = reg[7] - 2;
+    uint16_t target = (reg[7] + 2 * offset) & 0177777;
+
+    if(!z){ 
+        reg[7] = (reg[7] + 2 * offset) & 0177777; 
+        branch_taken++; 
+    } 
+
+    branch_execs++;
+    EXEC(branch_event)(pc, target, !z);
+
+    // clamp offset for printing
+    offset = offset & 0xFF;
+
+    // instruction trace
+    if (trace || verbose) {
+        printf("bne instruction with offset 0%03o\n", offset);
+    }
+
+    // value dump
+    if (verbose) {
+        // register dump
+        pregs();
+    }
+}
+
+STATIC void EXEC(br)(uint16_t operand)
+{
+    #ifdef DEBUG
+    printf("----------br: operand = %d----------\n", operand);
+    #endif
+    
+    // Branch site for the predictor models
+    uint16_t pc = reg[7] - 2;
+
+    // Get 8 bit offset
+    reg[7] += 2 * (int8_t)operand;
+
+    // Update branches taken
+    branch_taken++;
+    branch_execs++;
+    EXEC(branch_event)(pc, reg[7], true);
+
+    // instruction trace
+    if (trace || verbose) {
+        printf("br instruction with offset %04o\n", (int8_t) operand);
+    }
+
+    // value dump
+    if (verbose) {
+        // register dump
+        pregs();
+    }
+}
+
+STATIC void EXEC(cmp)(uint16_t operand)
+{
+    #ifdef DEBUG
+    printf("----------cmp: operand = %d----------\n", operand);
+    #endif
+
+    // Get source and destination address phrases
+    src.mode = (operand & 0x0E00) >> 9;
+    src.reg = (operand & 0x01C0) >> 6;
+    dst.mode = (operand & 0x0038) >> 3;
+    dst.reg = (operand & 0x0007);
+
+    // Get source and destination values
+    EXEC(get_operand)(&src);
+    EXEC(get_operand)(&dst);
+
+    // Compare
+    uint16_t result = src.value - dst.value;
+
+    // Set flags
+    n = result & 0x8000;
+    z = result == 0;
+    v = (src.value & 0x8000) != (dst.value & 0x8000);
+    c = (src.value < dst.value);
+
+    // instruction trace
+    if (trace || verbose) {
+        printf("cmp instruction sm %o, sr %o dm %o dr %o\n", src.mode, src.reg, dst.mode, dst.reg);
+    }
+
+    // value dump
+    if (verbose) {
+        printf("  src.value = %07o\n  dst.value = %07o\n  result    = %07o\n", src.value, dst.value, result);
+        printf("  nzvc bits = 4'b%d%d%d%d\n", n, z, v, c);
+
+        // register dump
+        pregs();
+    }
+}
+
+STATIC void EXEC(halt)(uint16_t operand)
+{
+    #ifdef DEBUG
+    printf("----------halt: operand = %d----------\n", operand);
+    #endif
+
+    // Halt; the console still sends the character it holds
+    running = 0;
+    console_drain();
+
+    // instruction trace
+    if (trace || verbose) {
+        printf("halt instruction\n");
+    }
+
+    // value dump
+    if (verbose) {
+        // register dump
+        pregs();
+    }
+}
+
+STATIC void EXEC(mov)(uint16_t operand)
+{
+    #ifdef DEBUG
+    printf("----------mov: operand = %d----------\n", operand);
+    #endif
+
+    // Get source and destination address phrases
+    src.mode = (operand & 0x0E00) >> 9;
+    src.reg = (operand & 0x01C0) >> 6;
+    dst.mode = (operand & 0x0038) >> 3;
+    dst.reg = (operand & 0x0007);
+
+    // Get source and destination values
+    EXEC(get_operand)(&src);
+    EXEC(get_operand)(&dst);
+
+    // Move
+    dst.value = src.value;
+
+    // Store destination value in memory or register
+    EXEC(put_operand)(&dst);
+
+    // Set flags
+    n = dst.value & 0x8000;
+    z = dst.value == 0;
+    v = 0;
+    c = 0;
+
+    // instruction trace
+    if (trace || verbose)
+    {
+        printf("mov instruction sm %o, sr %o dm %o dr %o\n", src.mode, src.reg, dst.mode, dst.reg);
+    }
+
+    if (verbose) {
+        printf("  src.value = %07o\n", src.value);
+        printf("  nzvc bits = 4'b%d%d%d%d\n", n, z, v, c);
+
+        // if value is written to memory, print
+        if (dst.mode == 2 || dst.mode == 3) {
+            printf("  value %07o is written to %07o\n", dst.value, dst.addr);
+        }
+        
+        // register dump
+        pregs();
+    }
+}
+
+STATIC void EXEC(rti)(uint16_t operand)
+{
+    #ifdef DEBUG
+    printf("----------rti: operand = %d----------\n", operand);
+    #endif
+
+    // Pop PC, then PSW
+    reg[7] = bus_read(reg[6]);
+    EXEC(data_access)(reg[6], MODE_READ);
+    reg[6] += 2;
+    uint16_t psw = bus_read(reg[6]);
+    EXEC(data_access)(reg[6], MODE_READ);
+    reg[6] += 2;
+    memory_reads += 2;
+    psw_set(psw);
+
+    // instruction trace
+    if (trace || verbose) {
+        printf("rti instruction\n");
+    }
+
+    // value dump
+    if (verbose) {
+        printf("  nzvc bits = 4'b%d%d%d%d\n", n, z, v, c);
+
+        // register dump
+        pregs();
+    }
+}
+
+STATIC void EXEC(sob)(uint16_t operand)
+{
+    #ifdef DEBUG
+    printf("----------sob: operand = %d----------\n", operand); 
+    #endif
+
+    // Get register index
+    int reg_index = (operand & 0x01C0) >> 6;
+    
+    // Get 6 bit offset
+    int offset = operand & 0x003F;
+
+    // Branch site and target for the predictor models
+    uint16_t pc = reg[7] - 2;
+    uint16_t target = reg[7] - 2 * offset;
+
+    // Subtract one from register
+    reg[reg_index]--;
+
+    // Branch if register is not zero
+    if (reg[reg_index] != 0)
+    {
+        reg[7] -= 2 * offset;
+        branch_taken++;
+    }
+
+    branch_execs++;
+    EXEC(branch_event)(pc, target, reg[reg_index] != 0);
+
+    // instruction trace
+    if (trace || verbose)
+    {
+        printf("sob instruction reg %o with offset %03o\n", reg_index, offset);
+    }
+
+    // value dump
+    if (verbose) {
+      
+        // register dump
+        pregs();
+    }
+}
+
+STATIC void EXEC(sub)(uint16_t operand)
+{
+    #ifdef DEBUG
+    printf("----------sub: operand = %d----------\n", operand);
+    #endif
+
+    // Get source and destination address phrases
+    src.mode = (operand & 0x0E00) >> 9;
+    src.reg = (operand & 0x01C0) >> 6;
+    dst.mode = (operand & 0x0038) >> 3;
+    dst.reg = (operand & 0x0007);
+
+    // Get source and destination values
+    EXEC(get_operand)(&src);
+    EXEC(get_operand)(&dst);
+
+    // Subtract
+    uint16_t result = dst.value - src.value;
+
+    // Ensure result is 16 bits
+    result &= 0xFFFF;
+
+    // Store destination value in memory or register
+    if (dst.mode == 0)
+    {
+        reg[dst.reg] = result;
+    }
+    else
+    {
+        bus_write(dst.value, result);
+        EXEC(data_access)(dst.value, MODE_WRITE);
+    }
+
+    // Set flags
+    n = result & 0x8000;
+    z = result == 0;
+    v = (src.value & 0x8000) != (dst.value & 0x8000);
+    c = src.value > dst.value;
+
+    // instruction trace
+    if (trace || verbose)
+    {
+        printf("sub instruction sm %o, sr %o dm %o dr %o\n", src.mode, src.reg, dst.mode, dst.reg);
+    }
+
+    // value dump
+    if (verbose) {
+        printf("  src.value = %07o\n  dst.value = %07o\n  result    = %07o\n", src.value, dst.value, result);
+        printf("  nzvc bits = 4'b%d%d%d%d\n", n, z, v, c);
+        
+        // register dump
+        pregs();
+    }
+}
+
+STATIC void EXEC(wait_inst)(uint16_t operand)
+{
+    #ifdef DEBUG
+    printf("----------wait: operand = %d----------\n", operand);
+    #endif
+
+    // Execute again until an interrupt is taken; with nothing scheduled
+    // or pending no interrupt can come, so stop instead of spinning
+    if (next_event == SCHED_NEVER)
+    {
+        printf("WAIT with no interrupt source at %06o\n", inst_pc);
+        running = 0;
+    }
+    else
+    {
+        waiting = true;
+        reg[7] -= 2;
+    }
+
+    // instruction trace
+    if (trace || verbose) {
+        printf("wait instruction\n");
+    }
+
+    // value dump
+    if (verbose) {
+        // register dump
+        pregs();
+    }
+}
+
+// The main loop is left out when the core is linked into microbench
+#ifndef MICROBENCH
+
+// Fetch and execute a single instruction
+static inline void EXEC(step)(void)
+{
+    if(trace || verbose) printf("at %05o, ", reg[7]);
+
+    // Get instruction from memory
+    uint16_t instruction = bus_read(reg[7]);
+    inst_pc = reg[7];
+    EXEC(fetch_access)(reg[7]);
+    reg[7] += 2;
+
+    #ifdef DEBUG
+    printf("\nexecuting instruction %05o at address %05o\n", instruction, reg[7]-1);
+    #endif
+
+    EXEC(operate)(instruction);
+}
+
+// Main loop, no per-instruction bookkeeping beyond the counters
+static void EXEC(run)(void)
+{
+    while (running)
+    {
+        EXEC(step)();
+        if ((uint64_t)inst_execs >= next_event) sched_service();
+        else if (reg[7] <= inst_pc)
+        {
+            // A backward branch: a sob over one instruction may be done in
+            // closed form, anything else may be an idle loop
+            if (reg[7] + 2 == inst_pc && loops_active && loop_run(HOOKED))
+            {
+                // The loop may have stopped where an event falls due
+                if ((uint64_t)inst_execs >= next_event) sched_service();
+            }
+            else if (next_event != SCHED_NEVER && idle_active) idle_check();
+        }
+    }
+}
+
+#endif /* MICROBENCH */
+
+#undef EXEC
+#undef STATIC
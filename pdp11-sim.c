@@ -11,8 +11,54 @@
  * 
  */
 
-// Run command format: ./a.out <flags>
-// Flags: -t (instruction trace), -v (verbose trace)
+// Run command format: ./a.out <flags> [< program.txt]
+// Flags: -t (instruction trace), -v (verbose trace),
+//        -B (one-line benchmark summary with host time),
+//        -l <file> (load the program from <file> instead of stdin),
+//        -F <octal|bin|lda|aout> (image format, default from the file
+//                                 name: .bin, .lda, .out, else octal),
+//        -a <addr> (load address in octal, default 0),
+//        -s <addr> (start PC in octal, default the image's entry point
+//                   or the load address),
+//        -O <file> (write memory after loading to <file> and exit),
+//        -M <file> (map a memory image written by -O copy-on-write as the
+//                   initial memory, shared between instances),
+//        -U <KiB> (KT11 MMU with <KiB> of physical memory, up to 4096,
+//                  translation on and mapped 1:1 at start),
+//        -k <N> (KW11-L line clock ticking every N instructions),
+//        -I <file> (characters for the console receiver, read one at a
+//                   time from <file>),
+//        -n (interpret idle loops instead of skipping them to the next
+//            event),
+//        -X (interpret sob loops instead of running them in closed form),
+//        -g <file> (debugger commands from <file>, or stdin with "-"
+//                   when the program comes from -l; see debug.c),
+//        -c <N> (instructions between the debugger's checkpoints),
+//        -j <file> (record the console input polled by the guest, with
+//                   the instruction count of each byte, to <file>),
+//        -J <file> (replay console input recorded by -j instead of -I),
+//        -C (no cache model; with no other analyses, the core runs
+//            without any access hooks),
+//        -p <csv> (hot-spot profile, per-block counts written to <csv>),
+//        -m <csv> (opcode and addressing mode histograms, exported to <csv>),
+//        -3 (classify cache misses as compulsory, capacity or conflict),
+//        -w <wb|wt>,<wa|nwa> (cache write policy),
+//        -W <depth>,<coalesce|nocoalesce>,<drain> (write buffer model),
+//        -P <next|stride:N|stream:N>:<degree>:<distance> (prefetcher),
+//        -D <banks>,<open|closed>,<tRCD>,<tCAS>,<tRP> (DRAM timing),
+//        -e (host performance counters around the main loop),
+//        -E (as -e, also broken down by guest opcode class),
+//        -i <N>,<file> (counter snapshot every N instructions, written to
+//                       <file> as CSV, or binary if it ends in .bin),
+//        -S <N>,<k>[,<file>] (basic-block vectors per N instructions,
+//                             k-means into k simulation points),
+//        -r <window> (reuse distance histograms, working set per <window>
+//                     accesses),
+//        -T <MHz> (cycle timing model at the given guest clock),
+//        -L <hit>,<miss>,<wb> (cache latencies in cycles for -T),
+//        -b <predictor> (branch predictor model, may be repeated; one of
+//                        static, btfn, bimodal:<entries>,
+//                        gshare:<entries>:<history bits>, btb:<entries>)
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -22,30 +68,47 @@
 #include <ctype.h>
 #include <math.h>
 #include <assert.h>
+#include <time.h>
 
 #include "cache.h"
-
-// Defines
-#define MEMSIZE (32*1024)
-#define MODE_READ 0
-#define MODE_WRITE 1
-
-/* struct top help organize source and destination operand handling */
-typedef struct ap {
-    int mode;
-    int reg;
-    int addr; /* used only for modes 1-7 */
-    int value;
-} addr_phrase_t;
+#include "pdp11-sim.h"
+#include "profile.h"
+#include "mix.h"
+#include "bpred.h"
+#include "timing.h"
+#include "perfctr.h"
+#include "interval.h"
+#include "simpoint.h"
+#include "reuse.h"
+#include "wbuf.h"
+#include "prefetch.h"
+#include "dram.h"
+#include "hooks.h"
+#include "loader.h"
+#include "unibus.h"
+#include "mmu.h"
+#include "events.h"
+#include "devices.h"
+#include "idle.h"
+#include "loops.h"
+#include "ckpt.h"
+#include "debug.h"
+#include "journal.h"
 
 // Global variables
-uint16_t memory[MEMSIZE]; // 16-bit memory
+uint16_t memory_store[MEMSIZE]; // 16-bit memory
+uint16_t *memory = memory_store; // memory_store, or a mapped memory image (-M)
+uint32_t memory_words = MEMSIZE; // entries in memory[], physical memory with -U
+uint8_t dirty_map[DIRTY_BYTES]; // pages stored to since the last checkpoint (ckpt.c)
 uint16_t reg[8] = {0}; // R0-R7
+uint16_t inst_pc; // Address of the instruction being executed
 bool n, z, v, c; // Condition codes
+uint16_t psw_high = 0; // PSW bits 15-4: current and previous mode, priority
 
 addr_phrase_t src, dst; // Source and destination address phrases
 
 bool running; // Flag to indicate if the program is running
+bool waiting = false; // Stopped in a WAIT instruction until an interrupt
 bool trace = false;
 bool verbose = false;
 int memory_reads = 0;
@@ -55,24 +118,98 @@ int inst_execs = 0;
 int branch_taken = 0;
 int branch_execs = 0;
 
-// Function prototypes
-void operate(uint16_t instruction);
-void get_operand(addr_phrase_t *phrase);
-void update_operand(addr_phrase_t *phrase);
-void put_operand(addr_phrase_t *phrase);
-void add(uint16_t operand);
-void asl(uint16_t operand);
-void asr(uint16_t operand);
-void beq(uint16_t operand);
-void bne(uint16_t operand);
-void br(uint16_t operand);
-void cmp(uint16_t operand);
-void halt(uint16_t operand);
-void mov(uint16_t operand);
-void sob(uint16_t operand);
-void sub(uint16_t operand);
-void pstats();
-void pregs();
+const char *op_names[NUM_OPS] = {
+    "mov", "cmp", "add", "sub", "sob", "br", "bne", "beq", "asr", "asl", "halt", "wait", "rti", "invalid"
+};
+
+bool bench = false; // print a one-line machine readable summary
+bool cache_enabled = true; // attach the cache model to the access hooks
+
+const char *image_path = NULL; // program image, NULL for octal text on stdin
+int image_format = LOAD_AUTO; // LOAD_* format, LOAD_AUTO guesses from the name
+uint16_t load_addr = 0; // where the image is loaded
+int32_t start_pc = -1; // initial PC, -1 for the image's own entry point
+const char *memory_image = NULL; // memory image mapped copy-on-write (-M)
+const char *save_image = NULL; // memory image to write after loading (-O)
+uint64_t host_ns = 0; // host time spent in the main loop
+
+const char *console_path = NULL; // console input (-I)
+const char *record_path = NULL; // journal of the console input to write (-j)
+const char *replay_path = NULL; // journal to take the console input from (-J)
+const char *debug_script = NULL; // debugger commands (-g), NULL when not debugging
+
+const char *profile_csv = NULL; // per-block profile output, NULL when not profiling
+const char *mix_csv = NULL; // instruction mix export, NULL when not collecting
+
+// Processor status word, also the last register on the I/O page
+uint16_t psw_get(void)
+{
+    return psw_high | (n << 3) | (z << 2) | (v << 1) | c;
+}
+
+void psw_set(uint16_t value)
+{
+    psw_high = value & 0177760;
+    n = (value >> 3) & 1;
+    z = (value >> 2) & 1;
+    v = (value >> 1) & 1;
+    c = value & 1;
+
+    // A lower priority may let a pending interrupt in
+    irq_check();
+}
+
+// Execution core, once plain and once reporting to the access hooks
+#define HOOKED 0
+#include "pdp11-exec.h"
+#undef HOOKED
+#ifndef MICROBENCH
+#define HOOKED 1
+#include "pdp11-exec.h"
+#undef HOOKED
+#endif
+
+// The main program; left out when the core is linked into microbench
+#ifndef MICROBENCH
+
+// PSW register on the I/O page
+static uint16_t psw_read(uint16_t addr)
+{
+    return psw_get();
+}
+
+static void psw_write(uint16_t addr, uint16_t value)
+{
+    psw_set(value);
+}
+
+// Main loop variants (run() and run_hooked() come from pdp11-exec.h)
+static void step_instrumented(void);
+static void run_instrumented(void);
+
+// Everything a checkpoint has to bring back to rerun from it
+static void ckpt_machine(void)
+{
+    ckpt_region(reg, sizeof(reg));
+    ckpt_region(&inst_pc, sizeof(inst_pc));
+    ckpt_region(&n, sizeof(n));
+    ckpt_region(&z, sizeof(z));
+    ckpt_region(&v, sizeof(v));
+    ckpt_region(&c, sizeof(c));
+    ckpt_region(&psw_high, sizeof(psw_high));
+    ckpt_region(&running, sizeof(running));
+    ckpt_region(&waiting, sizeof(waiting));
+    ckpt_region(&memory_reads, sizeof(memory_reads));
+    ckpt_region(&memory_writes, sizeof(memory_writes));
+    ckpt_region(&inst_fetches, sizeof(inst_fetches));
+    ckpt_region(&inst_execs, sizeof(inst_execs));
+    ckpt_region(&branch_taken, sizeof(branch_taken));
+    ckpt_region(&branch_execs, sizeof(branch_execs));
+    events_ckpt();
+    devices_ckpt();
+    if (mmu_present) mmu_ckpt();
+    if (journal_active) journal_ckpt();
+}
 
 // Main function
 int main(int argc, char *argv[])
@@ -85,12 +222,167 @@ int main(int argc, char *argv[])
     for (int i = 0; i < MEMSIZE; i++) memory[i] = 0;
     reg[7] = 0;
     cache_init();
+    unibus_register(PSW_ADDR, 1, psw_read, psw_write);
+    devices_init();
 
     // Check for flags
     for (int i = 1; i < argc; i++)
     {
         if (strcmp(argv[i], "-t") == 0) trace = true;
         else if (strcmp(argv[i], "-v") == 0) verbose = true;
+        else if (strcmp(argv[i], "-B") == 0) bench = true;
+        else if (strcmp(argv[i], "-n") == 0) idle_active = false;
+        else if (strcmp(argv[i], "-X") == 0) loops_active = false;
+        else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) image_path = argv[++i];
+        else if (strcmp(argv[i], "-M") == 0 && i + 1 < argc) memory_image = argv[++i];
+        else if (strcmp(argv[i], "-U") == 0 && i + 1 < argc)
+        {
+            if (!mmu_init(argv[++i]))
+            {
+                printf("Invalid physical memory size: %s\n", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc)
+        {
+            if (!clock_start(argv[++i]))
+            {
+                printf("Invalid clock period: %s\n", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc) console_path = argv[++i];
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) record_path = argv[++i];
+        else if (strcmp(argv[i], "-J") == 0 && i + 1 < argc) replay_path = argv[++i];
+        else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) debug_script = argv[++i];
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            if (!ckpt_init(argv[++i]))
+            {
+                printf("Invalid checkpoint interval: %s\n", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-O") == 0 && i + 1 < argc) save_image = argv[++i];
+        else if (strcmp(argv[i], "-F") == 0 && i + 1 < argc)
+        {
+            image_format = load_format(argv[++i]);
+            if (image_format < 0)
+            {
+                printf("Invalid image format: %s\n", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc)
+        {
+            char *end;
+            long addr = strtol(argv[++i], &end, 8);
+            if (*end != '\0' || addr < 0 || addr >= MEMSIZE || (addr & 1))
+            {
+                printf("Invalid load address: %s\n", argv[i]);
+                exit(1);
+            }
+            load_addr = addr;
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            char *end;
+            long pc = strtol(argv[++i], &end, 8);
+            if (*end != '\0' || pc < 0 || pc >= MEMSIZE || (pc & 1))
+            {
+                printf("Invalid start address: %s\n", argv[i]);
+                exit(1);
+            }
+            start_pc = pc;
+        }
+        else if (strcmp(argv[i], "-C") == 0) cache_enabled = false;
+        else if (strcmp(argv[i], "-3") == 0) cache_classify();
+        else if (strcmp(argv[i], "-e") == 0) perf_init(false);
+        else if (strcmp(argv[i], "-E") == 0) perf_init(true);
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) profile_csv = argv[++i];
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) mix_csv = argv[++i];
+        else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc)
+        {
+            double mhz = atof(argv[++i]);
+            if (mhz <= 0)
+            {
+                printf("Invalid clock rate: %s\n", argv[i]);
+                exit(1);
+            }
+            timing_init(mhz);
+        }
+        else if (strcmp(argv[i], "-L") == 0 && i + 1 < argc)
+        {
+            if (!timing_latencies(argv[++i]))
+            {
+                printf("Invalid cache latencies: %s\n", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+        {
+            if (!interval_init(argv[++i]))
+            {
+                printf("Invalid interval spec: %s\n", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc)
+        {
+            if (!simpoint_init(argv[++i]))
+            {
+                printf("Invalid simpoint spec: %s\n", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+        {
+            if (!cache_policy(argv[++i]))
+            {
+                printf("Invalid write policy: %s\n", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-W") == 0 && i + 1 < argc)
+        {
+            if (!wbuf_config(argv[++i]))
+            {
+                printf("Invalid write buffer: %s\n", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-D") == 0 && i + 1 < argc)
+        {
+            if (!dram_init(argv[++i]))
+            {
+                printf("Invalid DRAM spec: %s\n", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc)
+        {
+            if (!prefetch_init(argv[++i]))
+            {
+                printf("Invalid prefetcher: %s\n", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            if (!reuse_init(argv[++i]))
+            {
+                printf("Invalid working set window: %s\n", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+        {
+            if (!bpred_add(argv[++i]))
+            {
+                printf("Invalid branch predictor: %s\n", argv[i]);
+                exit(1);
+            }
+        }
         else
         {
             printf("Invalid flag: %s\n", argv[i]);
@@ -98,954 +390,356 @@ int main(int argc, char *argv[])
         }
     }
     
-    // Read instructions into memory
-    char line[100];
-    int i = 0;
-    if (verbose) printf("\nreading words in octal from stdin:\n");
-    while (fgets(line, sizeof(line), stdin) != NULL)
+    // Attach the models to the access hooks, the cache first so the
+    // prefetcher behind it sees the outcome of each access
+    if (cache_enabled) cache_attach();
+    else if (prefetch_active)
     {
-        // Read a word into every other memory location
-        memory[i] = (uint16_t)strtol(line, NULL, 8);
-
-        // verbose trace
-        if (verbose) printf("  %07o\n", memory[i]);
-        i += 2;
-    }
-
-    // Loop through memory
-    if (trace || verbose) printf("\ninstruction trace:\n");
-    while (reg[7] < MEMSIZE && running)
-    {
-        if(trace || verbose) printf("at %05o, ", reg[7]);
-
-        // Get instruction from memory
-        uint16_t instruction = memory[reg[7]];
-        cache_access(reg[7], MODE_READ);
-        reg[7] += 2;
-
-        #ifdef DEBUG
-        printf("\nexecuting instruction %05o at address %05o\n", instruction, reg[7]-1);
-        #endif
-
-        operate(instruction);
-
-        // ensure PC is not out of bounds
-        if(reg[7] >= MEMSIZE)
-        {
-            printf("PC out of bounds: %d\n", reg[7]);
-            exit(1);
-        }
+        printf("Prefetcher needs the cache\n");
+        exit(1);
     }
+    if (prefetch_active) prefetch_attach();
+    if (reuse_active) reuse_attach();
+    if (bpred_active) bpred_attach();
 
-    // Print execution statistics
-    pstats();
-}
-
-// Function definitions
-void operate(uint16_t instruction) {
+    // Idle loops are skipped only when the cache is all that watches the
+    // references and no trace has to show every iteration
+    if (prefetch_active || reuse_active || bpred_active || wbuf_active || trace || verbose)
+        idle_active = false;
 
-    // Execute 4 bit opcode
-    if(((instruction & 0xF000) >> 12) == 01) // mov
+    // Console input from a file or terminal, recorded or not, or from a
+    // journal of an earlier run
+    if (replay_path != NULL && (console_path != NULL || record_path != NULL))
     {
-        mov(instruction);
+        printf("-J cannot be used with -I or -j\n");
+        exit(1);
     }
-    else if(((instruction & 0xF000) >> 12) == 02) // cmp
+    if (record_path != NULL && console_path == NULL)
     {
-        cmp(instruction);
+        printf("-j needs -I\n");
+        exit(1);
     }
-    else if(((instruction & 0xF000) >> 12) == 06) // add
+    if (record_path != NULL && !journal_record(record_path))
     {
-        add(instruction);
+        printf("Cannot write journal: %s\n", record_path);
+        exit(1);
     }
-    else if(((instruction & 0xF000) >> 12) == 016) // sub
+    if (replay_path != NULL && !journal_replay(replay_path))
     {
-        sub(instruction);
+        printf("Cannot read journal: %s\n", replay_path);
+        exit(1);
     }
-
-    // Opcode is not 4 bits, try 7
-    else if(((instruction & 0xFE00) >> 9) == 077) // sob
+    if ((console_path != NULL || replay_path != NULL) && !console_input(console_path))
     {
-        sob(instruction);
+        printf("Cannot open console input: %s\n", console_path);
+        exit(1);
     }
 
-    // Opcode is not 7 bits, try 8
-    else if(((instruction & 0xFF00) >> 8) == 001) // br
+    // The debugger's script; stdin only when the program is not on it
+    if (debug_script != NULL)
     {
-        br(instruction);
-    }
-    else if(((instruction & 0xFF00) >> 8) == 002) // bne
-    {
-        bne(instruction);
+        if (strcmp(debug_script, "-") == 0 && image_path == NULL)
+        {
+            printf("-g - needs the program from -l\n");
+            exit(1);
+        }
+        if (!debug_open(debug_script))
+        {
+            printf("Cannot open debugger commands: %s\n", debug_script);
+            exit(1);
+        }
     }
-    else if(((instruction & 0xFF00) >> 8) == 003) // beq
+
+    // Closed-form loops replay every reference to the hooks, so only a
+    // trace needs them interpreted
+    if (trace || verbose) loops_active = false;
+
+    // Read the program into memory, starting at the image's entry point
+    // unless -s gave one; a mapped memory image already holds it
+    int32_t entry = load_addr;
+    if (memory_image != NULL)
     {
-        beq(instruction);
+        if (image_path != NULL || mmu_present)
+        {
+            printf("-M cannot be used with -l or -U\n");
+            exit(1);
+        }
+        if (!map_memory(memory_image)) exit(1);
     }
+    else if (!load_image(image_path, image_format, load_addr, &entry)) exit(1);
+    reg[7] = start_pc >= 0 ? start_pc : entry;
 
-    // Opcode is not 8 bits, try 10
-    else if(((instruction & 0xFFC0) >> 6) == 0062) // asr
+    // Build a memory image for -M and stop
+    if (save_image != NULL) exit(save_memory(save_image) ? 0 : 1);
+
+    // Loop through memory
+    if (trace || verbose) printf("\ninstruction trace:\n");
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (perf_active) perf_start();
+    bool instrumented = profile_csv != NULL || mix_csv != NULL || timing_active ||
+                        perf_by_class || interval_active || simpoint_active;
+    if (profile_csv != NULL) profile_init();
+    if (mix_csv != NULL) mix_init();
+    if (debug_script != NULL)
     {
-        asr(instruction);
+        // Instructions stepped in the debugger see the same analyses as
+        // the run loop; what it executes again sees none of them
+        ckpt_machine();
+        debug_run(instrumented ? step_instrumented :
+                  hooks_active ? step_hooked : step, step);
     }
-    else if(((instruction & 0xFFC0) >> 6) == 0063) // asl
+    if (instrumented)
     {
-        asl(instruction);
+        run_instrumented();
     }
-
-    // Opcode is not 10 bits, try 16
-    else if(instruction == 0000) // halt
+    else if (hooks_active)
     {
-        halt(instruction);
+        run_hooked();
     }
-
-    // Invalid opcode
     else
     {
-        printf("Invalid opcode: %d\n", instruction);
-        exit(1);
-    }
-
-    // Increment instruction execution count
-    inst_execs++;
-
-    // Increment instruction fetch count
-    inst_fetches++;
-}
-
-void get_operand( addr_phrase_t *phrase) {
-    #ifdef DEBUG
-    printf("get_operand: mode = %d, reg = %d\n", phrase->mode, phrase->reg);
-    #endif
-
-    assert( (phrase->mode >= 0) && (phrase->mode <= 7) );
-    assert( (phrase->reg >= 0) && (phrase->reg <= 7) );
-    
-    // Decide register mode
-    switch( phrase->mode ) {
-
-        /* register */
-        case 0:
-            phrase->value = reg[phrase->reg];
-            break;
-
-        /* register indirect */
-        case 1:
-            phrase->addr = reg[phrase->reg ];  /* address is in the register */
-            assert( phrase->addr < MEMSIZE );
-
-            phrase->value = memory[phrase->addr ];  /* value is in memory */
-            memory_reads++;
-            // cache_access(phrase->addr, MODE_READ);
-            assert( phrase->value < 0200000 );
-
-            #ifdef DEBUG
-            printf("get_operand: addr: %07o, value: %07o\n", phrase->addr, phrase->value);
-            #endif
-            break;
-
-        /* autoincrement (post reference) */
-        case 2:
-            // Update PC mode
-            if( phrase->reg == 7 ) { // Immediate mode
-                #ifdef DEBUG
-                printf("get_operand: immediate mode\n");
-                #endif
-
-                // Operand is in the next word in memory
-                phrase->addr = reg[phrase->reg];
-                inst_fetches++;
-                // cache_access(phrase->addr, MODE_READ);
-                reg[7] += 2;
-                assert( phrase->value < 0200000 );
-            }
-            // Update register mode
-            else {
-                phrase->addr = reg[phrase->reg];  /* address is in the register */
-                assert( phrase->addr < MEMSIZE );
-                reg[phrase->reg] += 2;  /* increment the register */
-            }
-
-            phrase->value = memory[phrase->addr];  /* value is in memory */
-            cache_access(phrase->addr, MODE_READ);
-
-            #ifdef DEBUG
-            printf("get_operand: addr: %07o, value: %07o\n", phrase->addr, phrase->value);
-            #endif
-            break;
-
-        /* autoincrement indirect */
-        case 3:
-            // Update PC mode
-            if( phrase->reg == 7 ) { // Absolute mode
-                #ifdef DEBUG
-                printf("get_operand: absolute mode\n");
-                #endif
-
-                // The address of the operand is in the next word
-                phrase->addr = memory[reg[7]];
-                // cache_access(reg[7], MODE_READ);
-                inst_fetches++;
-                reg[7] += 2;
-                assert( phrase->addr < MEMSIZE );
-
-                memory_reads++;
-            }
-
-            // Update register mode
-            else {
-                phrase->addr = reg[phrase->reg];  /* address is in the register */
-                assert( phrase->addr < MEMSIZE );
-                phrase->addr = memory[phrase->addr];  /* address is in memory */
-                // cache_access(phrase->addr, MODE_READ);
-                assert( phrase->addr < MEMSIZE );
-
-                memory_reads += 2;
-            }
-
-            // The value of the operand is in memory
-            phrase->value = memory[phrase->addr];
-            assert( phrase->value < 0200000 );
-            cache_access(phrase->addr, MODE_READ);
-
-            // Increment the register
-            reg[phrase->reg] += 2;
-
-            #ifdef DEBUG
-            printf("get_operand: addr: %07o, value: %07o\n", phrase->addr, phrase->value);
-            #endif
-            break;
-
-        /* autodecrement */
-        case 4:
-            reg[phrase->reg] -= 2;  /* decrement the register */
-            phrase->addr = reg[phrase->reg];  /* address is in the register */
-            assert( phrase->addr < MEMSIZE );
-
-            phrase->value = memory[phrase->addr];  /* value is in memory */
-            cache_access(phrase->addr, MODE_READ);
-            memory_reads++;
-            assert( phrase->value < 0200000 );
-            break;
-
-        /* autodecrement indirect */
-        case 5:
-            reg[phrase->reg] -= 2;  /* decrement the register */
-            phrase->addr = reg[phrase->reg];  /* address is in the register */
-            assert( phrase->addr < MEMSIZE );
-            phrase->addr = memory[phrase->addr];  /* address is in memory */
-            cache_access(phrase->addr, MODE_READ);
-            memory_reads++;
-            assert( phrase->addr < MEMSIZE );
-            
-            phrase->value = memory[phrase->addr];  /* value is in memory */
-            cache_access(phrase->addr, MODE_READ);
-            memory_reads++;
-
-            #ifdef DEBUG
-            printf("get_operand: addr: %07o, value: %07o\n", phrase->addr, phrase->value);
-            #endif
-            break;
-
-        /* index */
-        case 6:
-            // Update PC mode
-            if( phrase->reg == 7 ) { // Relative mode
-                // The address of the operand is in the next word of the instruction added to the PC
-                phrase->addr = memory[reg[7]] + reg[7];
-                //cache_access(reg[7], MODE_READ);
-                inst_fetches++;
-                reg[7] += 2;
-                assert( phrase->addr < MEMSIZE );
-            }
-
-            // Update register mode
-            else {
-                phrase->addr = memory[reg[7]] + reg[phrase->reg];
-                //cache_access(reg[7], MODE_READ);
-                inst_fetches++;
-                reg[7] += 2;
-                assert( phrase->addr < MEMSIZE );
-            }
-
-            // Get value from memory
-            phrase->value = memory[phrase->addr];
-            cache_access(phrase->addr, MODE_READ);
-            memory_reads += 2;
-            assert( phrase->value < 0200000 );
-
-            #ifdef DEBUG
-            printf("get_operand: addr: %07o, value: %07o\n", phrase->addr, phrase->value);
-            #endif
-            break;
-
-        /* index indirect */
-        case 7:
-            // Update PC mode
-            if( phrase->reg == 7 ) { // Relative deferred mode
-                // The address of the address of the operand is the next word of the instruction added to reg[7]
-                phrase->addr = memory[reg[7]] + reg[7];
-                // cache_access(reg[7], MODE_READ);
-                inst_fetches++;
-                assert( phrase->addr < MEMSIZE );
-            }
-
-            // Update register mode
-            else {
-                phrase->addr = memory[reg[7]] + reg[phrase->reg];
-                // cache_access(reg[7], MODE_READ);
-                inst_fetches++;
-                // Fix out of bounds addresses
-                while( phrase->addr >= MEMSIZE ) {
-                    phrase->addr -= MEMSIZE;
-                }
-                assert( phrase->addr < MEMSIZE );
-            }
-            reg[7] += 2;
-
-            // Get value from memory
-            cache_access(phrase->addr, MODE_READ);
-            phrase->addr = memory[phrase->addr];
-            assert( phrase->addr < MEMSIZE );
-            phrase->value = memory[phrase->addr];
-            cache_access(phrase->addr, MODE_READ);
-            memory_reads += 2;
-            assert( phrase->value < 0200000 );
-
-            #ifdef DEBUG
-            printf("get_operand: addr: %07o, value: %07o\n", phrase->addr, phrase->value);
-            #endif
-            break;
-
-        default:
-            printf("unimplemented address mode %o\n", phrase->mode);
-            exit(1);
-    }
-}
-
-void update_operand(addr_phrase_t *phrase) {
-    assert( (phrase->mode >= 0) && (phrase->mode <= 7) );
-    assert( (phrase->reg >= 0) && (phrase->reg <= 7) );
-
-    // Decide register mode
-    switch( phrase->mode ) {
-
-        /* register */
-        case 0:
-            reg[phrase->reg] = phrase->value;
-            break;
-
-        /* register indirect */
-        case 1:
-            memory[phrase->addr] = phrase->value;
-            cache_access(phrase->addr, MODE_WRITE);
-            memory_writes++;
-            break;
-
-        /* autoincrement (post reference) */
-        case 2:
-            // Update PC mode
-            if( phrase->reg == 7 ) { // Immediate mode
-                // Immediate mode has no address
-                // Do nothing
-            }
-            // Update register mode
-            else {
-                memory[phrase->addr] = phrase->value;
-                cache_access(phrase->addr, MODE_WRITE);
-                memory_writes++;
-            }
-            break;
-
-        /* autoincrement indirect */
-        case 3:
-            // Get value from memory
-            memory[phrase->addr] = phrase->value;
-            cache_access(phrase->addr, MODE_WRITE);
-            memory_writes++;
-            break;
-
-        /* autodecrement */
-        case 4:
-            memory[phrase->addr] = phrase->value;
-            cache_access(phrase->addr, MODE_WRITE);
-            memory_writes++;
-            break;
-
-        /* autodecrement indirect */
-        case 5:
-            memory[phrase->addr] = phrase->value;
-            cache_access(phrase->addr, MODE_WRITE);
-            memory_writes++;
-            break;
-
-        /* index */
-        case 6:
-            // Get value from memory
-            memory[phrase->addr] = phrase->value;
-            cache_access(phrase->addr, MODE_WRITE);
-            memory_writes++;
-            break;
-
-        /* index indirect */
-        case 7:
-            // Get value from memory
-            memory[phrase->addr] = phrase->value;
-            cache_access(phrase->addr, MODE_WRITE);
-            memory_writes++;
-            break;
+        run();
     }
-}
-
-void put_operand(addr_phrase_t *phrase) {
-    assert( (phrase->mode >= 0) && (phrase->mode <= 7) );
-    assert( (phrase->reg >= 0) && (phrase->reg <= 7) );
-
-    // Decide register mode
-    switch( phrase->mode ) {
-
-        /* register */
-        case 0:
-            reg[phrase->reg] = phrase->value;
-            break;
-
-        /* register indirect */
-        case 1:
-            memory[phrase->addr] = phrase->value;
-            cache_access(phrase->addr, MODE_WRITE);
-            memory_writes++;
-            break;
-
-        /* autoincrement (post reference) */
-        case 2:
-            // Update PC mode
-            if( phrase->reg == 7 ) { // Immediate mode
-                // Immediate mode has no address
-                // Do nothing
-            }
-            // Update register mode
-            else {
-                memory[phrase->addr] = phrase->value;
-                cache_access(phrase->addr, MODE_WRITE);
-                memory_writes++;
-            }
-            break;
-
-        /* autoincrement indirect */
-        case 3:
-            // Get value from memory
-            memory[phrase->addr] = phrase->value;
-            cache_access(phrase->addr, MODE_WRITE);
-            memory_writes++;
-            break;
-
-        /* autodecrement */
-        case 4:
-            memory[phrase->addr] = phrase->value;
-            cache_access(phrase->addr, MODE_WRITE);
-            memory_writes++;
-            break;
-
-        /* autodecrement indirect */
-        case 5:
-            memory[phrase->addr] = phrase->value;
-            cache_access(phrase->addr, MODE_WRITE);
-            memory_writes++;
-            break;
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    if (perf_active) perf_stop();
+    host_ns = (uint64_t)(stop.tv_sec - start.tv_sec) * 1000000000 + (stop.tv_nsec - start.tv_nsec);
 
-        /* index */
-        case 6:
-            // Get value from memory
-            memory[phrase->addr] = phrase->value;
-            cache_access(phrase->addr, MODE_WRITE);
-            memory_writes++;
-            break;
+    // Print execution statistics
+    pstats();
 
-        /* index indirect */
-        case 7:
-            // Get value from memory
-            memory[phrase->addr] = phrase->value;
-            cache_access(phrase->addr, MODE_WRITE);
-            memory_writes++;
-            break;
-    }
+    if (profile_csv != NULL) profile_report(profile_csv);
+    if (mix_csv != NULL) mix_export(mix_csv);
+    if (interval_active) interval_write();
 }
 
-void add(uint16_t operand)
+// One instruction with the per-instruction analyses (profile, instruction
+// mix, timing, host counters by opcode class, interval sampling, basic-block
+// vectors) attached, including any event it makes due; selected once in
+// main() so the plain loop pays nothing for them. Always runs the hooked
+// core, the analyses read the cache counters
+static void step_instrumented(void)
 {
-    #ifdef DEBUG
-    printf("----------add: operand = %d----------\n", operand);
-    #endif
+    uint16_t pc = reg[7];
+    uint16_t instruction = 0;
+    unsigned int old_hits = hits;
+    unsigned int old_misses = misses;
+    unsigned int old_write_backs = write_backs;
+    int old_reads = memory_reads;
+    int old_writes = memory_writes;
+    int old_taken = branch_taken;
+    int old_branches = branch_execs;
+    uint64_t old_counters[PERF_MAX];
 
-    // Get source and destination address phrases
-    src.mode = (operand & 0x0E00) >> 9;
-    src.reg = (operand & 0x01C0) >> 6;
-    dst.mode = (operand & 0x0038) >> 3;
-    dst.reg = (operand & 0x0007);
+    // The word step_hooked() is about to fetch, read through the MMU
+    // without counting or faulting
+    bus_peek(pc, &instruction);
 
-    // Get source and destination values
-    get_operand(&src);
-    get_operand(&dst);
+    if (perf_by_class) perf_snapshot(old_counters);
 
-    // Save old value of destination
-    uint16_t old_dst = dst.value;
+    step_hooked();
+    if ((uint64_t)inst_execs >= next_event) sched_service();
 
-    // Add source and destination
-    dst.value = dst.value + src.value;
+    if (perf_by_class) perf_class(decode(instruction), old_counters);
 
-    // Ensure that the result is 16 bits
-    dst.value = dst.value & 0xFFFF;
-
-    // Write back to memory
-    update_operand(&dst);
-
-    // Set condition codes
-    n = dst.value >> 15;
-    z = (dst.value == 0);
-    v = ((old_dst >> 15) == (src.value >> 15)) && ((dst.value >> 15) != (src.value >> 15));
-    c = (dst.value < old_dst);
-
-    // instruction trace
-    if (trace || verbose)
+    if (profile_csv != NULL)
     {
-        printf("add instruction sm %o, sr %o dm %o dr %o\n", src.mode, src.reg, dst.mode, dst.reg);
-    }
-
-    // verbose
-    if (verbose) {
-        printf("  src.value = %07o\n  dst.value = %07o\n  result    = %07o\n", src.value, old_dst, dst.value);
-        printf("  nzvc bits = 4'b%d%d%d%d\n", n, z, v, c);
-        
-        // register dump
-        pregs();
+        profile_inst(pc, misses - old_misses, branch_taken != old_taken,
+                     branch_execs != old_branches);
     }
-}
-
-void asl(uint16_t operand)
-{
-    #ifdef DEBUG
-    printf("----------asl: operand = %d----------\n", operand);
-    #endif
-
-    // Get address phrase
-    dst.mode = (operand & 0x0038) >> 3;
-    dst.reg = (operand & 0x0007);
-    
-    // Get value
-    get_operand(&dst);
-    
-    // Save old value
-    uint16_t old_value = dst.value;
-
-    // Shift left
-    dst.value = dst.value << 1;
-
-    // Clamp to 16 bits
-    dst.value = dst.value & 0xFFFF;
-
-    // Write back to memory
-    update_operand(&dst);
-
-    // Set condition codes
-    n = dst.value & 0x8000;
-    z = dst.value == 0;
-    v = (old_value & 0x8000) != (dst.value & 0x8000);
-    c = (old_value & 0x8000) != 0;
-
-    // instruction trace
-    if (trace || verbose)
+    if (mix_csv != NULL)
     {
-        printf("asl instruction dm %o dr %o\n", dst.mode, dst.reg);
+        mix_inst(decode(instruction), instruction, memory_reads - old_reads,
+                 memory_writes - old_writes, misses - old_misses);
     }
-
-    // value dump
-    if (verbose) {
-        printf("  dst.value = %07o\n  result    = %07o\n", old_value, dst.value);
-        printf("  nzvc bits = 4'b%d%d%d%d\n", n, z, v, c);
-        
-        // register dump
-        pregs();
-    }
-}
-
-void asr(uint16_t operand)
-{
-    #ifdef DEBUG
-    printf("----------asr: operand = %d----------\n", operand);
-    #endif
-
-    // Get address phrase
-    dst.mode = (operand & 0x0038) >> 3;
-    dst.reg = (operand & 0x0007);
-
-    // Get value
-    get_operand(&dst);
-
-    // Save old value
-    uint16_t old_value = dst.value;
-
-    // Copy sign bit
-    uint16_t sign_bit = dst.value & 0x8000;
-
-    // Shift right
-    dst.value = dst.value >> 1;
-
-    // Write sign bit
-    dst.value = dst.value | sign_bit;
-
-    // Ensure that the result is 16 bits
-    dst.value = dst.value & 0xFFFF;
-
-    // Write back to memory
-    update_operand(&dst);
-
-    // Set condition codes
-    n = dst.value & 0x8000;
-    z = dst.value == 0;
-    v = ((old_value & 0x8000) && ((old_value & 0x0001) == 0)) || (!(old_value & 0x8000) && (old_value & 0x0001));
-    c = (old_value & 0x0001) != 0;
-
-    // instruction trace
-    if (trace || verbose)
+    if (timing_active)
     {
-        printf("asr instruction dm %o dr %o\n", dst.mode, dst.reg);
-    }
-
-    // value dump
-    if (verbose) {
-        printf("  dst.value = %07o\n  result    = %07o\n", old_value, dst.value);
-        printf("  nzvc bits = 4'b%d%d%d%d\n", n, z, v, c);
-        
-        // register dump
-        pregs();
+        timing_inst(decode(instruction), instruction, branch_taken != old_taken,
+                    hits - old_hits, misses - old_misses, write_backs - old_write_backs);
     }
+    if (interval_active && inst_execs >= interval_next) interval_sample();
+    if (simpoint_active) simpoint_inst(pc, branch_execs != old_branches);
 }
 
-void beq(uint16_t operand)
+// Main loop with the analyses attached
+static void run_instrumented(void)
 {
-    #ifdef DEBUG
-    printf("----------beq: operand = %d----------\n", operand);
-    #endif
-
-    int offset = operand & 0377;          /* 8-bit signed offset */ 
+    while (running) step_instrumented();
+}
 
-    offset = offset << 24;       /* sign extend to 32 bits */ 
-    offset = offset >> 24; 
+#endif /* MICROBENCH */
 
-    #ifdef DEBUG
-    printf("operand: %o, offset: %o\n", operand, offset);
-    #endif
+// Function definitions
+int decode(uint16_t instruction) {
 
-    if(z){ 
-        reg[7] = (reg[7] + (offset << 1)) & 0177777; 
-        branch_taken++; 
+    // Try 4 bit opcode
+    switch((instruction & 0xF000) >> 12)
+    {
+        case 01: return OP_MOV;
+        case 02: return OP_CMP;
+        case 06: return OP_ADD;
+        case 016: return OP_SUB;
     }
 
-    branch_execs++;
-
-    // clamp offset for printing
-    offset = offset & 0xFF;
+    // Opcode is not 4 bits, try 7
+    if(((instruction & 0xFE00) >> 9) == 077) return OP_SOB;
 
-    // instruction trace
-    if (trace || verbose) {
-        printf("beq instruction with offset %04o\n", offset);
+    // Opcode is not 7 bits, try 8
+    switch((instruction & 0xFF00) >> 8)
+    {
+        case 001: return OP_BR;
+        case 002: return OP_BNE;
+        case 003: return OP_BEQ;
     }
 
-    // value dump
-    if (verbose) {
-        // register dump
-        pregs();
+    // Opcode is not 8 bits, try 10
+    switch((instruction & 0xFFC0) >> 6)
+    {
+        case 0062: return OP_ASR;
+        case 0063: return OP_ASL;
     }
-}
-
-void bne(uint16_t operand)
-{
-    #ifdef DEBUG
-    printf("----------bne: operand = %d----------\n", operand);
-    #endif
-
-    int offset = operand & 0377;          /* 8-bit signed offset */ 
 
-    offset = offset << 24;       /* sign extend to 32 bits */ 
-    offset = offset >> 24; 
-
-    #ifdef DEBUG
-    printf("operand: %o, offset: %o\n", operand, offset);
-    #endif
-
-    if(!z){ 
-        reg[7] = (reg[7] + (offset << 1)) & 0177777; 
-        branch_taken++; 
-    } 
-
-    branch_execs++;
-
-    // clamp offset for printing
-    offset = offset & 0xFF;
-
-    // instruction trace
-    if (trace || verbose) {
-        printf("bne instruction with offset 0%03o\n", offset);
-    }
+    // Opcode is not 10 bits, try 16
+    if(instruction == 0000) return OP_HALT;
+    if(instruction == 0001) return OP_WAIT;
+    if(instruction == 0002) return OP_RTI;
 
-    // value dump
-    if (verbose) {
-        // register dump
-        pregs();
-    }
+    return OP_INVALID;
 }
 
-void br(uint16_t operand)
-{
-    #ifdef DEBUG
-    printf("----------br: operand = %d----------\n", operand);
-    #endif
-    
-    // Get 8 bit offset
-    reg[7] += 2 * (int8_t)operand;
-
-    // Update branches taken
-    branch_taken++;
-    branch_execs++;
+void pstats() {
+    printf("\nexecution statistics (in decimal):\n");
+    printf("  instructions executed     = %d\n", inst_execs);
+    printf("  instruction words fetched = %d\n", inst_fetches);
+    printf("  data words read           = %d\n", memory_reads);
+    printf("  data words written        = %d\n", memory_writes);
+    printf("  branches executed         = %d\n", branch_execs);
 
-    // instruction trace
-    if (trace || verbose) {
-        printf("br instruction with offset %04o\n", (int8_t) operand);
+    // avoid dividing by zero
+    if (branch_execs == 0) {
+        printf("  branches taken            = %d\n", branch_taken);
+    } else {
+        printf("  branches taken            = %d (%0.1f%%)\n", branch_taken, (float) (branch_taken * 100) / branch_execs);
     }
 
-    // value dump
-    if (verbose) {
-        // register dump
-        pregs();
-    }
-}
+    if (cache_enabled) cache_stats();
+    if (prefetch_active) prefetch_stats();
+    if (dram_active) dram_stats();
+    if (mmu_present) mmu_stats();
+    if (events_fired || interrupts_taken) sched_stats();
+    if (idle_skipped) idle_stats();
+    if (loops_run) loop_stats();
+    if (debug_script != NULL) ckpt_stats();
+    if (journal_active) journal_stats();
 
-void cmp(uint16_t operand)
-{
-    #ifdef DEBUG
-    printf("----------cmp: operand = %d----------\n", operand);
-    #endif
-
-    // Get source and destination address phrases
-    src.mode = (operand & 0x0E00) >> 9;
-    src.reg = (operand & 0x01C0) >> 6;
-    dst.mode = (operand & 0x0038) >> 3;
-    dst.reg = (operand & 0x0007);
-
-    // Get source and destination values
-    get_operand(&src);
-    get_operand(&dst);
-
-    // Compare
-    uint16_t result = src.value - dst.value;
-
-    // Set flags
-    n = result & 0x8000;
-    z = result == 0;
-    v = (src.value & 0x8000) != (dst.value & 0x8000);
-    c = (src.value < dst.value);
-
-    // instruction trace
-    if (trace || verbose) {
-        printf("cmp instruction sm %o, sr %o dm %o dr %o\n", src.mode, src.reg, dst.mode, dst.reg);
-    }
+    if (mix_csv != NULL) mix_stats();
+    if (bpred_active) bpred_stats(inst_execs);
+    if (timing_active) timing_stats(inst_execs);
 
-    // value dump
-    if (verbose) {
-        printf("  src.value = %07o\n  dst.value = %07o\n  result    = %07o\n", src.value, dst.value, result);
-        printf("  nzvc bits = 4'b%d%d%d%d\n", n, z, v, c);
+    if (perf_active) perf_stats(inst_execs);
+    if (simpoint_active) simpoint_report();
+    if (reuse_active) reuse_stats();
 
-        // register dump
-        pregs();
+    // Stable one-line summary for bench/run.sh
+    if (bench) {
+        unsigned long rss = 0, shared = 0;
+        resident_kb(&rss, &shared);
+        printf("bench: insts=%d host_ns=%llu cache_hits=%u cache_misses=%u load_ns=%llu"
+               " rss_kb=%lu shared_kb=%lu\n",
+               inst_execs, (unsigned long long)host_ns, hits, misses,
+               (unsigned long long)load_ns, rss, shared);
     }
-}
-
-void halt(uint16_t operand)
-{
-    #ifdef DEBUG
-    printf("----------halt: operand = %d----------\n", operand);
-    #endif
-
-    // Halt
-    running = 0;
 
-    // instruction trace
-    if (trace || verbose) {
-        printf("halt instruction\n");
-    }
-
-    // value dump
     if (verbose) {
-        // register dump
-        pregs();
+        // Print first 20 words of memory after execution halts
+        printf("\nfirst 20 words of memory after execution halts:\n");
+        for(int i = 0; i < 40; i += 2) printf("  %05o: %06o\n", i, memory[i]);
     }
 }
 
-void mov(uint16_t operand)
+void pregs() {
+    printf("  R0:%07o  R2:%07o  R4:%07o  R6:%07o\n", reg[0], reg[2], reg[4], reg[6]);
+    printf("  R1:%07o  R3:%07o  R5:%07o  R7:%07o\n", reg[1], reg[3], reg[5], reg[7]);
+}
+// The word at a virtual address as the program would read it, 0 where
+// the read would fault; disassembly must not disturb the machine
+static uint16_t dis_word(uint16_t addr)
 {
-    #ifdef DEBUG
-    printf("----------mov: operand = %d----------\n", operand);
-    #endif
-
-    // Get source and destination address phrases
-    src.mode = (operand & 0x0E00) >> 9;
-    src.reg = (operand & 0x01C0) >> 6;
-    dst.mode = (operand & 0x0038) >> 3;
-    dst.reg = (operand & 0x0007);
-
-    // Get source and destination values
-    get_operand(&src);
-    get_operand(&dst);
-
-    // Move
-    dst.value = src.value;
-
-    // Store destination value in memory or register
-    put_operand(&dst);
-
-    // Set flags
-    n = dst.value & 0x8000;
-    z = dst.value == 0;
-    v = 0;
-    c = 0;
-
-    // instruction trace
-    if (trace || verbose)
-    {
-        printf("mov instruction sm %o, sr %o dm %o dr %o\n", src.mode, src.reg, dst.mode, dst.reg);
-    }
-
-    if (verbose) {
-        printf("  src.value = %07o\n", src.value);
-        printf("  nzvc bits = 4'b%d%d%d%d\n", n, z, v, c);
-
-        // if value is written to memory, print
-        if (dst.mode == 2 || dst.mode == 3) {
-            printf("  value %07o is written to %07o\n", dst.value, dst.addr);
-        }
-        
-        // register dump
-        pregs();
-    }
+    uint16_t word = 0;
+    bus_peek(addr, &word);
+    return word;
 }
 
-void sob(uint16_t operand)
+// Format one operand in MACRO-11 syntax; addr is where its index word
+// would be, returns the number of extra instruction words used
+static int dis_operand(int mode, int r, uint16_t addr, char *buf, size_t len)
 {
-    #ifdef DEBUG
-    printf("----------sob: operand = %d----------\n", operand); 
-    #endif
+    static const char *names[8] = {"r0", "r1", "r2", "r3", "r4", "r5", "sp", "pc"};
+    uint16_t word = dis_word(addr);
 
-    // Get register index
-    int reg_index = operand & 0x0007;
-    
-    // Get 6 bit offset
-    int offset = operand & 0x003F;
-
-    // Subtract one from register
-    reg[reg_index]--;
-
-    // Branch if register is not zero
-    if (reg[reg_index] != 0)
+    // PC modes read like immediate, absolute and relative operands
+    if (r == 7)
     {
-        reg[7] -= 2 * offset;
-        branch_taken++;
+        switch (mode)
+        {
+            case 2: snprintf(buf, len, "#%o", word); return 1;
+            case 3: snprintf(buf, len, "@#%o", word); return 1;
+            case 6: snprintf(buf, len, "%o", (uint16_t)(word + addr)); return 1;
+            case 7: snprintf(buf, len, "@%o", (uint16_t)(word + addr)); return 1;
+        }
     }
 
-    branch_execs++;
-
-    // instruction trace
-    if (trace || verbose)
+    switch (mode)
     {
-        printf("sob instruction reg %o with offset %03o\n", reg_index, offset);
-    }
-
-    // value dump
-    if (verbose) {
-      
-        // register dump
-        pregs();
+        case 0: snprintf(buf, len, "%s", names[r]); return 0;
+        case 1: snprintf(buf, len, "(%s)", names[r]); return 0;
+        case 2: snprintf(buf, len, "(%s)+", names[r]); return 0;
+        case 3: snprintf(buf, len, "@(%s)+", names[r]); return 0;
+        case 4: snprintf(buf, len, "-(%s)", names[r]); return 0;
+        case 5: snprintf(buf, len, "@-(%s)", names[r]); return 0;
+        case 6: snprintf(buf, len, "%o(%s)", word, names[r]); return 1;
+        default: snprintf(buf, len, "@%o(%s)", word, names[r]); return 1;
     }
 }
 
-void sub(uint16_t operand)
+// Disassemble the instruction at pc into buf, returns its length in words
+int disasm(uint16_t pc, char *buf, size_t len)
 {
-    #ifdef DEBUG
-    printf("----------sub: operand = %d----------\n", operand);
-    #endif
-
-    // Get source and destination address phrases
-    src.mode = (operand & 0x0E00) >> 9;
-    src.reg = (operand & 0x01C0) >> 6;
-    dst.mode = (operand & 0x0038) >> 3;
-    dst.reg = (operand & 0x0007);
-
-    // Get source and destination values
-    get_operand(&src);
-    get_operand(&dst);
-
-    // Subtract
-    uint16_t result = dst.value - src.value;
+    uint16_t instruction = dis_word(pc);
+    int op = decode(instruction);
+    char s[32], d[32];
+    int words = 1;
 
-    // Ensure result is 16 bits
-    result &= 0xFFFF;
-
-    // Store destination value in memory or register
-    if (dst.mode == 0)
-    {
-        reg[dst.reg] = result;
-    }
-    else
+    switch (op)
     {
-        memory[dst.value] = result;
-        cache_access(dst.value, MODE_WRITE);
-    }
-
-    // Set flags
-    n = result & 0x8000;
-    z = result == 0;
-    v = (src.value & 0x8000) != (dst.value & 0x8000);
-    c = src.value > dst.value;
-
-    // instruction trace
-    if (trace || verbose)
-    {
-        printf("sub instruction sm %o, sr %o dm %o dr %o\n", src.mode, src.reg, dst.mode, dst.reg);
-    }
+        // Double operand
+        case OP_MOV: case OP_CMP: case OP_ADD: case OP_SUB:
+            words += dis_operand((instruction & 0x0E00) >> 9, (instruction & 0x01C0) >> 6, pc + 2 * words, s, sizeof(s));
+            words += dis_operand((instruction & 0x0038) >> 3, instruction & 0x0007, pc + 2 * words, d, sizeof(d));
+            snprintf(buf, len, "%s %s,%s", op_names[op], s, d);
+            break;
 
-    // value dump
-    if (verbose) {
-        printf("  src.value = %07o\n  dst.value = %07o\n  result    = %07o\n", src.value, dst.value, result);
-        printf("  nzvc bits = 4'b%d%d%d%d\n", n, z, v, c);
-        
-        // register dump
-        pregs();
-    }
-}
+        // Single operand
+        case OP_ASR: case OP_ASL:
+            words += dis_operand((instruction & 0x0038) >> 3, instruction & 0x0007, pc + 2 * words, d, sizeof(d));
+            snprintf(buf, len, "%s %s", op_names[op], d);
+            break;
 
-void pstats() {
-    printf("\nexecution statistics (in decimal):\n");
-    printf("  instructions executed     = %d\n", inst_execs);
-    printf("  instruction words fetched = %d\n", inst_fetches);
-    printf("  data words read           = %d\n", memory_reads);
-    printf("  data words written        = %d\n", memory_writes);
-    printf("  branches executed         = %d\n", branch_execs);
+        case OP_SOB:
+            snprintf(buf, len, "sob r%o,%o", (instruction & 0x01C0) >> 6,
+                     (uint16_t)(pc + 2 - 2 * (instruction & 0x003F)));
+            break;
 
-    // avoid dividing by zero
-    if (branch_execs == 0) {
-        printf("  branches taken            = %d\n", branch_taken);
-    } else {
-        printf("  branches taken            = %d (%0.1f%%)\n", branch_taken, (float) (branch_taken * 100) / branch_execs);
-    }
+        case OP_BR: case OP_BNE: case OP_BEQ:
+            snprintf(buf, len, "%s %o", op_names[op], (uint16_t)(pc + 2 + 2 * (int8_t)instruction));
+            break;
 
-    cache_stats();
+        case OP_HALT: case OP_WAIT: case OP_RTI:
+            snprintf(buf, len, "%s", op_names[op]);
+            break;
 
-    if (verbose) {
-        // Print first 20 words of memory after execution halts
-        printf("\nfirst 20 words of memory after execution halts:\n");
-        for(int i = 0; i < 40; i += 2) printf("  %05o: %06o\n", i, memory[i]);
+        default:
+            snprintf(buf, len, ".word %06o", instruction);
     }
+    return words;
 }
-
-void pregs() {
-    printf("  R0:%07o  R2:%07o  R4:%07o  R6:%07o\n", reg[0], reg[2], reg[4], reg[6]);
-    printf("  R1:%07o  R3:%07o  R5:%07o  R7:%07o\n", reg[1], reg[3], reg[5], reg[7]);
-}
\ No newline at end of file
@@ -0,0 +1,96 @@
+/**
+ * @file pdp11-sim.h
+ * @author Charles "Blue" Hartsell (ckharts@clemson.edu)
+ * @brief Shared machine state of the PDP-11 simulator
+ * @version 0.1
+ * @date 2022-10-26
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef PDP11_SIM_H
+#define PDP11_SIM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Defines
+#define MEMSIZE (64*1024) // the whole 16-bit address space, I/O page included
+#define MODE_READ 0
+#define MODE_WRITE 1
+#define PAGE_SHIFT 8 // dirty page size, 256 entries of memory[]
+#define DIRTY_BYTES (((4096*1024) >> PAGE_SHIFT) / 8) // bitmap for the largest memory[] (-U 4096)
+
+/* opcodes known to the decoder, in operate() order */
+enum {
+    OP_MOV, OP_CMP, OP_ADD, OP_SUB, OP_SOB, OP_BR, OP_BNE, OP_BEQ,
+    OP_ASR, OP_ASL, OP_HALT, OP_WAIT, OP_RTI, OP_INVALID, NUM_OPS
+};
+
+/* struct top help organize source and destination operand handling */
+typedef struct ap {
+    int mode;
+    int reg;
+    int addr; /* used only for modes 1-7 */
+    int value;
+} addr_phrase_t;
+
+// Global variables
+extern uint16_t *memory; // 16-bit memory, MEMSIZE words
+extern uint32_t memory_words; // entries in memory[], more with the MMU
+extern uint8_t dirty_map[DIRTY_BYTES]; // pages of memory[] stored to since the last checkpoint
+extern uint16_t reg[8]; // R0-R7
+extern uint16_t inst_pc; // Address of the instruction being executed
+extern bool n, z, v, c; // Condition codes
+extern uint16_t psw_high; // PSW bits 15-4: modes, priority
+
+extern addr_phrase_t src, dst; // Source and destination address phrases
+
+extern bool running; // Flag to indicate if the program is running
+extern bool waiting; // Stopped in a WAIT instruction until an interrupt
+extern bool trace;
+extern bool verbose;
+extern bool bench;
+extern bool cache_enabled;
+extern uint64_t host_ns;
+extern int memory_reads;
+extern int memory_writes;
+extern int inst_fetches;
+extern int inst_execs;
+extern int branch_taken;
+extern int branch_execs;
+extern const char *op_names[NUM_OPS];
+
+// Note a store to memory[index]; one OR, so it is always on
+static inline void mark_dirty(uint32_t index)
+{
+    dirty_map[index >> (PAGE_SHIFT + 3)] |= 1 << ((index >> PAGE_SHIFT) & 7);
+}
+
+// Function prototypes
+int decode(uint16_t instruction);
+void operate(uint16_t instruction);
+void get_operand(addr_phrase_t *phrase);
+void update_operand(addr_phrase_t *phrase);
+void put_operand(addr_phrase_t *phrase);
+void add(uint16_t operand);
+void asl(uint16_t operand);
+void asr(uint16_t operand);
+void beq(uint16_t operand);
+void bne(uint16_t operand);
+void br(uint16_t operand);
+void cmp(uint16_t operand);
+void halt(uint16_t operand);
+void mov(uint16_t operand);
+void rti(uint16_t operand);
+void sob(uint16_t operand);
+void sub(uint16_t operand);
+uint16_t psw_get(void);
+void psw_set(uint16_t value);
+int disasm(uint16_t pc, char *buf, size_t len);
+void pstats();
+void pregs();
+
+#endif
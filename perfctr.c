@@ -0,0 +1,201 @@
+/* host performance counters around the simulator main loop
+ *
+ * reads Linux hardware counters through perf_event_open(2) so that
+ *   interpreter slowness can be split into host cycles, instructions,
+ *   branch mispredicts, and L1 data cache misses per guest instruction
+ *
+ * routines
+ *
+ *   void perf_init( bool by_class );
+ *   void perf_start( void );
+ *   void perf_stop( void );
+ *   void perf_snapshot( uint64_t *values );
+ *   void perf_class( int op, const uint64_t *before );
+ *   void perf_stats( int insts );
+ *
+ * perf_start() and perf_stop() bracket the main loop; with by_class
+ *   set, the instrumented main loop also takes a perf_snapshot() before
+ *   each guest instruction and hands it to perf_class() afterwards,
+ *   which charges the deltas to the instruction's opcode class - every
+ *   snapshot is one read(2) of the whole counter group, so expect the
+ *   per-class numbers to include that syscall
+ *
+ * fallbacks, tried in order
+ *
+ *   hardware  cycles, instructions, branch-misses, L1d read misses;
+ *             any counter the PMU refuses is dropped from the group
+ *   software  task-clock (ns), context switches, page faults - used
+ *             when no hardware counter opens, e.g. in most VMs
+ *   clock     nothing opens at all (perf_event_paranoid, seccomp);
+ *             only the main loop wall time from clock_gettime is shown
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "pdp11-sim.h"
+#include "perfctr.h"
+
+enum { CLASS_DOUBLE, CLASS_SINGLE, CLASS_BRANCH, CLASS_OTHER, NUM_CLASSES };
+
+static const char *class_names[NUM_CLASSES] = {
+  "double operand", "single operand", "branch", "other"
+};
+
+typedef struct {
+  const char *name;
+  uint32_t type;
+  uint64_t config;
+} counter_def_t;
+
+static const counter_def_t
+  hardware[PERF_MAX] = {
+    { "cycles",        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { "L1d-misses",    PERF_TYPE_HW_CACHE,
+      PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) }
+  },
+  software[PERF_MAX] = {
+    { "task-clock-ns",    PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+    { "context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+    { "page-faults",      PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+    { NULL, 0, 0 }
+  };
+
+static const char *names[PERF_MAX];  /* counters that opened, group order */
+static int num_counters = 0;
+static int leader = -1;              /* group leader fd */
+static const char *source = "clock";
+
+static uint64_t
+  totals[PERF_MAX],                  /* main loop totals */
+  start_values[PERF_MAX],
+  by_class[NUM_CLASSES][PERF_MAX],
+  class_insts[NUM_CLASSES];
+
+bool perf_active = false;
+bool perf_by_class = false;
+
+static int open_counter( const counter_def_t *def, int group ){
+  struct perf_event_attr attr;
+  memset( &attr, 0, sizeof( attr ) );
+  attr.size = sizeof( attr );
+  attr.type = def->type;
+  attr.config = def->config;
+  attr.disabled = group == -1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return syscall( SYS_perf_event_open, &attr, 0, -1, group, 0 );
+}
+
+/* open as many counters of one set as possible into a single group */
+
+static void open_group( const counter_def_t *set ){
+  int i, fd;
+  for( i=0; i<PERF_MAX && set[i].name != NULL; i++ ){
+    fd = open_counter( &set[i], leader );
+    if( fd < 0 ) continue;
+    if( leader == -1 ) leader = fd;
+    names[num_counters++] = set[i].name;
+  }
+}
+
+void perf_init( bool by_class_on ){
+  /* a repeated -e/-E keeps the group already open; -E still adds the
+     per-class breakdown */
+  if( perf_active ){
+    perf_by_class = perf_by_class || by_class_on;
+    return;
+  }
+  memset( totals, 0, sizeof( totals ) );
+  memset( by_class, 0, sizeof( by_class ) );
+  memset( class_insts, 0, sizeof( class_insts ) );
+
+  open_group( hardware );
+  if( num_counters > 0 ){
+    source = "hardware";
+  }else{
+    open_group( software );
+    if( num_counters > 0 ) source = "software";
+  }
+
+  perf_active = true;
+  perf_by_class = by_class_on;
+}
+
+/* read the whole group at once; values are in group order */
+
+void perf_snapshot( uint64_t *values ){
+  uint64_t buf[1+PERF_MAX];
+  int i;
+  if( leader == -1 ) return;
+  if( read( leader, buf, sizeof( buf ) ) <= 0 ) return;
+  for( i=0; i<num_counters && i<(int)buf[0]; i++ ) values[i] = buf[1+i];
+}
+
+void perf_start( void ){
+  if( leader == -1 ) return;
+  ioctl( leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+  perf_snapshot( start_values );
+}
+
+void perf_stop( void ){
+  uint64_t end[PERF_MAX] = { 0 };
+  int i;
+  if( leader == -1 ) return;
+  perf_snapshot( end );
+  ioctl( leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP );
+  for( i=0; i<num_counters; i++ ) totals[i] = end[i] - start_values[i];
+}
+
+void perf_class( int op, const uint64_t *before ){
+  uint64_t after[PERF_MAX] = { 0 };
+  int i, class;
+
+  switch( op ){
+    case OP_MOV: case OP_CMP: case OP_ADD: case OP_SUB: class = CLASS_DOUBLE; break;
+    case OP_ASR: case OP_ASL: class = CLASS_SINGLE; break;
+    case OP_BR: case OP_BNE: case OP_BEQ: case OP_SOB: class = CLASS_BRANCH; break;
+    default: class = CLASS_OTHER;
+  }
+
+  perf_snapshot( after );
+  for( i=0; i<num_counters; i++ ) by_class[class][i] += after[i] - before[i];
+  class_insts[class]++;
+}
+
+void perf_stats( int insts ){
+  int i, class;
+
+  printf( "host counters (in decimal, %s):\n", source );
+  printf( "  main loop time    = %llu ns (%0.2f ns per guest instruction)\n",
+          (unsigned long long)host_ns, insts ? (double)host_ns / insts : 0.0 );
+  for( i=0; i<num_counters; i++ ){
+    printf( "  %-17s = %llu (%0.2f per guest instruction)\n", names[i],
+            (unsigned long long)totals[i], insts ? (double)totals[i] / insts : 0.0 );
+  }
+  if( num_counters == 0 ){
+    printf( "  (perf_event_open unavailable, wall clock only)\n" );
+  }
+
+  if( !perf_by_class || num_counters == 0 ) return;
+  printf( "host counters per guest instruction by opcode class:\n" );
+  printf( "  %-16s %10s", "class", "insts" );
+  for( i=0; i<num_counters; i++ ) printf( " %14s", names[i] );
+  printf( "\n" );
+  for( class=0; class<NUM_CLASSES; class++ ){
+    if( class_insts[class] == 0 ) continue;
+    printf( "  %-16s %10llu", class_names[class], (unsigned long long)class_insts[class] );
+    for( i=0; i<num_counters; i++ ){
+      printf( " %14.2f", (double)by_class[class][i] / class_insts[class] );
+    }
+    printf( "\n" );
+  }
+}
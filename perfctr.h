@@ -0,0 +1,19 @@
+#ifndef PERFCTR_H
+#define PERFCTR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PERF_MAX 4
+
+extern bool perf_active;
+extern bool perf_by_class;
+
+void perf_init( bool by_class );
+void perf_start( void );
+void perf_stop( void );
+void perf_snapshot( uint64_t *values );
+void perf_class( int op, const uint64_t *before );
+void perf_stats( int insts );
+
+#endif
@@ -0,0 +1,250 @@
+/* hardware prefetcher models in front of the cache
+ *
+ * the prefetcher sees every demand access after cache_access() has
+ *   handled it (prefetch_attach() puts it on the access hooks after
+ *   the cache), and installs lines ahead of demand with
+ *   cache_prefetch(); cache.c tracks what becomes of each prefetched line
+ *
+ * routines
+ *
+ *   bool prefetch_init( const char *spec );
+ *   void prefetch_attach( void );
+ *   void prefetch_access( uint16_t pc, uint16_t address, bool fetch );
+ *   void prefetch_stats( void );
+ *
+ * prefetcher specs accepted by prefetch_init() (entries must be a
+ *   power of 2, buffers at most PREFETCH_STREAMS)
+ *
+ *   next:<degree>:<distance>
+ *       tagged next-line: a miss, or the first use of a prefetched
+ *       line, fetches <degree> lines after skipping <distance> lines
+ *       past the one referenced
+ *   stride:<entries>:<degree>:<distance>
+ *       per-PC stride table for data accesses, with a separate entry
+ *       for each data reference an instruction makes (so both sides
+ *       of mov (r0)+,(r1)+ are tracked); once the same stride
+ *       has been seen twice in a row from an instruction, fetches
+ *       <degree> strides ahead after skipping <distance> strides
+ *   stream:<buffers>:<degree>:<distance>
+ *       stream buffers: two misses to adjacent lines start a stream in
+ *       that direction; each later trigger inside the stream's window
+ *       advances it and fetches <degree> lines ahead after skipping
+ *       <distance> lines; the least recently used buffer is reallocated
+ *
+ * a prefetch is issued only when the line is not already cached; it
+ *   arrives PREFETCH_LATENCY cache accesses later, so a demand
+ *   reference before then counts as late rather than useful
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+#include "prefetch.h"
+#include "hooks.h"
+
+enum { NEXT_LINE, STRIDE, STREAM };
+
+typedef struct {
+  uint16_t pc;    /* instruction that owns the entry */
+  int slot;       /* which of its data references    */
+  uint16_t last;  /* last address it referenced      */
+  int stride;
+  int confidence; /* 0..3 */
+} stride_entry_t;
+
+typedef struct {
+  bool valid;
+  int dir;        /* +1, -1, or 0 while training */
+  int32_t last;   /* last line that advanced the stream */
+  uint64_t used;  /* LRU stamp */
+} stream_t;
+
+static int kind;
+static char name[40];
+static unsigned int
+  entries,
+  degree,
+  distance;
+
+static stride_entry_t *strides;
+static stream_t streams[PREFETCH_STREAMS];
+static uint64_t stamp = 0;
+
+static int slot;  /* data references the current instruction has made */
+
+static unsigned int
+  last_misses = 0,  /* cache misses seen so far     */
+  last_used = 0;    /* prefetched lines used so far */
+
+static uint64_t
+  issued = 0,     /* lines installed by a prefetch   */
+  redundant = 0;  /* prefetches of lines already in  */
+
+bool prefetch_active = false;
+
+bool prefetch_init( const char *spec ){
+  long n = 0, d, s;
+  char *end;
+
+  if( strncmp( spec, "next:", 5 ) == 0 ){
+    kind = NEXT_LINE;
+    end = (char *)spec + 4;
+  }else if( strncmp( spec, "stride:", 7 ) == 0 ){
+    kind = STRIDE;
+    n = strtol( spec+7, &end, 10 );
+    if( n < 1 || (n & (n-1)) != 0 ) return false;
+  }else if( strncmp( spec, "stream:", 7 ) == 0 ){
+    kind = STREAM;
+    n = strtol( spec+7, &end, 10 );
+    if( n < 1 || n > PREFETCH_STREAMS ) return false;
+  }else{
+    return false;
+  }
+  if( *end != ':' ) return false;
+  d = strtol( end+1, &end, 10 );
+  if( *end != ':' ) return false;
+  s = strtol( end+1, &end, 10 );
+  if( *end != '\0' || d < 1 || d > 64 || s < 0 || s > 64 ) return false;
+
+  entries = n;
+  degree = d;
+  distance = s;
+  if( kind == STRIDE ) strides = calloc( entries, sizeof( strides[0] ) );
+  snprintf( name, sizeof( name ), "%s", spec );
+  prefetch_active = true;
+  return true;
+}
+
+static void issue( int32_t line ){
+  if( line < 0 || line >= ADDR_LINES ) return;
+  if( cache_prefetch( line << LINE_SHIFT, PREFETCH_LATENCY ) ) issued++;
+  else redundant++;
+}
+
+static void stride_access( uint16_t pc, uint16_t address ){
+  stride_entry_t *e;
+  unsigned int i;
+  int delta;
+
+  e = &strides[((pc >> 1) + slot * 0x9E5) & (entries - 1)];
+
+  if( e->pc != pc || e->slot != slot ){
+    e->pc = pc;
+    e->slot = slot++;
+    e->last = address;
+    e->stride = 0;
+    e->confidence = 0;
+    return;
+  }
+  slot++;
+  delta = (int)address - (int)e->last;
+  e->last = address;
+  if( delta != 0 && delta == e->stride ){
+    if( e->confidence < 3 ) e->confidence++;
+  }else{
+    e->stride = delta;
+    e->confidence = 0;
+  }
+  if( e->confidence < 1 ) return;
+
+  /* skip strides that stay within the line already being referenced */
+
+  for( i=0; i<degree; i++ ){
+    int32_t target = address + e->stride * (int)(distance + 1 + i);
+    if( target >= 0 && (target >> LINE_SHIFT) != (address >> LINE_SHIFT) ){
+      issue( target >> LINE_SHIFT );
+    }
+  }
+}
+
+static void stream_access( int32_t line ){
+  stream_t *victim = &streams[0];
+  unsigned int i, j;
+
+  for( i=0; i<entries; i++ ){
+    stream_t *s = &streams[i];
+    if( !s->valid ) continue;
+    if( s->dir != 0 ){
+      int32_t ahead = (line - s->last) * s->dir;
+      if( ahead >= 1 && ahead <= (int32_t)(distance + degree) ){
+        s->last = line;
+        s->used = ++stamp;
+        for( j=0; j<degree; j++ ) issue( line + s->dir * (int)(distance + 1 + j) );
+        return;
+      }
+    }else if( line - s->last == 1 || line - s->last == -1 ){
+      s->dir = line - s->last;
+      s->last = line;
+      s->used = ++stamp;
+      for( j=0; j<degree; j++ ) issue( line + s->dir * (int)(distance + 1 + j) );
+      return;
+    }
+  }
+
+  /* no stream claims it - start training a new one */
+
+  for( i=0; i<entries; i++ ){
+    if( !streams[i].valid ){ victim = &streams[i]; break; }
+    if( streams[i].used < victim->used ) victim = &streams[i];
+  }
+  victim->valid = true;
+  victim->dir = 0;
+  victim->last = line;
+  victim->used = ++stamp;
+}
+
+void prefetch_access( uint16_t pc, uint16_t address, bool fetch ){
+  int32_t line = address >> LINE_SHIFT;
+  unsigned int i, used = prefetch_useful + prefetch_late;
+
+  /* a demand miss, or the first reference to a prefetched line */
+
+  bool trigger = misses != last_misses || used != last_used;
+
+  last_misses = misses;
+  last_used = used;
+
+  switch( kind ){
+    case NEXT_LINE:
+      if( trigger ) for( i=0; i<degree; i++ ) issue( line + distance + 1 + i );
+      break;
+    case STRIDE:
+      if( fetch && address == pc ) slot = 0;
+      if( !fetch ) stride_access( pc, address );
+      break;
+    case STREAM:
+      if( trigger ) stream_access( line );
+      break;
+  }
+}
+
+static void fetch_hook( uint16_t pc, uint16_t address ){
+  prefetch_access( pc, address, true );
+}
+
+static void data_hook( uint16_t pc, uint16_t address ){
+  prefetch_access( pc, address, false );
+}
+
+void prefetch_attach( void ){
+  hook_fetch( fetch_hook );
+  hook_read( data_hook );
+  hook_write( data_hook );
+}
+
+void prefetch_stats( void ){
+  unsigned int used = prefetch_useful + prefetch_late;
+  printf( "prefetch statistics (in decimal):\n" );
+  printf( "  prefetcher      = %s\n", name );
+  printf( "  issued          = %llu\n", (unsigned long long)issued );
+  printf( "  already cached  = %llu\n", (unsigned long long)redundant );
+  printf( "  useful          = %u\n", prefetch_useful );
+  printf( "  late            = %u\n", prefetch_late );
+  printf( "  unused          = %u\n", prefetch_unused );
+  printf( "  pollution       = %u (demand misses to lines a prefetch evicted)\n",
+          prefetch_pollution );
+  if( issued ) printf( "  accuracy        = %.2f%%\n", 100.0 * used / issued );
+  if( prefetch_useful + misses ) printf( "  coverage        = %.2f%%\n",
+                                         100.0 * prefetch_useful / (prefetch_useful + misses) );
+}
@@ -0,0 +1,17 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PREFETCH_LATENCY 8   /* cache accesses before a prefetch arrives */
+#define PREFETCH_STREAMS 16  /* most stream buffers */
+
+extern bool prefetch_active;
+
+bool prefetch_init( const char *spec );
+void prefetch_attach( void );
+void prefetch_access( uint16_t pc, uint16_t address, bool fetch );
+void prefetch_stats( void );
+
+#endif
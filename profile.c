@@ -0,0 +1,138 @@
+/* guest hot-spot profiler
+ *
+ * counts executions, cache misses, and taken branches for every guest
+ *   PC and for every dynamic basic block, in dense tables indexed by
+ *   the word address (PC/2) so the per-instruction cost is a handful of
+ *   increments with no lookups
+ *
+ * routines
+ *
+ *   void profile_init( void );
+ *   void profile_inst( uint16_t pc, unsigned int inst_misses,
+ *                      bool taken, bool branch );
+ *   void profile_report( const char *csv );
+ *
+ * profile_inst() is called by the profiling main loop after each
+ *   instruction with the PC it was fetched from, the number of cache
+ *   misses it caused, whether it took a branch, and whether it was a
+ *   branch at all; only that loop calls it, so a run without -p pays
+ *   nothing for the profiler
+ *
+ * a basic block here is a dynamic one: it starts at the first
+ *   instruction and at every instruction following a branch, and runs
+ *   up to and including the next branch; blocks are keyed by their
+ *   leader (first) PC
+ *
+ * profile_report() prints the PROFILE_TOP hottest PCs with disassembly
+ *   and writes one CSV row per executed block, addresses in octal
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pdp11-sim.h"
+#include "profile.h"
+
+#define WORDS (MEMSIZE/2)
+
+static uint64_t
+  pc_execs[WORDS],   /* executions of each PC           */
+  pc_misses[WORDS],  /* cache misses caused by each PC  */
+  pc_taken[WORDS],   /* taken branches at each PC       */
+
+  bb_execs[WORDS],   /* entries into each block, by leader */
+  bb_insts[WORDS],   /* instructions run in each block     */
+  bb_misses[WORDS],  /* cache misses in each block         */
+  bb_taken[WORDS];   /* taken branches leaving each block  */
+
+static uint16_t
+  bb_last[WORDS];    /* PC of the last instruction of each block */
+
+static unsigned int leader;  /* word index of the current block's leader */
+static bool new_block;       /* next instruction starts a block          */
+
+void profile_init( void ){
+  memset( pc_execs, 0, sizeof( pc_execs ) );
+  memset( pc_misses, 0, sizeof( pc_misses ) );
+  memset( pc_taken, 0, sizeof( pc_taken ) );
+  memset( bb_execs, 0, sizeof( bb_execs ) );
+  memset( bb_insts, 0, sizeof( bb_insts ) );
+  memset( bb_misses, 0, sizeof( bb_misses ) );
+  memset( bb_taken, 0, sizeof( bb_taken ) );
+  memset( bb_last, 0, sizeof( bb_last ) );
+  leader = 0;
+  new_block = true;
+}
+
+void profile_inst( uint16_t pc, unsigned int inst_misses, bool taken, bool branch ){
+  unsigned int i = pc >> 1;
+
+  if( new_block ){
+    leader = i;
+    bb_execs[leader]++;
+  }
+
+  pc_execs[i]++;
+  pc_misses[i] += inst_misses;
+  pc_taken[i] += taken;
+
+  bb_insts[leader]++;
+  bb_misses[leader] += inst_misses;
+  bb_taken[leader] += taken;
+  if( pc > bb_last[leader] ) bb_last[leader] = pc;
+
+  new_block = branch;
+}
+
+/* sort word indices by descending execution count, then by address */
+
+static int by_execs( const void *a, const void *b ){
+  unsigned int i = *(const unsigned int *)a, j = *(const unsigned int *)b;
+  if( pc_execs[i] != pc_execs[j] ) return pc_execs[i] < pc_execs[j] ? 1 : -1;
+  return i < j ? -1 : 1;
+}
+
+void profile_report( const char *csv ){
+  static unsigned int order[WORDS];
+  unsigned int i, count = 0;
+  uint64_t total = 0;
+  char text[64];
+  FILE *fp;
+
+  for( i=0; i<WORDS; i++ ){
+    if( pc_execs[i] ){
+      order[count++] = i;
+      total += pc_execs[i];
+    }
+  }
+  qsort( order, count, sizeof( order[0] ), by_execs );
+
+  printf( "\nflat profile (in decimal, addresses in octal):\n" );
+  printf( "  %%insts      execs     misses      taken  address  instruction\n" );
+  for( i=0; i<count && i<PROFILE_TOP; i++ ){
+    unsigned int w = order[i];
+    disasm( w << 1, text, sizeof( text ) );
+    printf( "  %5.1f%% %10llu %10llu %10llu   %06o  %s\n",
+            100.0 * pc_execs[w] / total, (unsigned long long)pc_execs[w],
+            (unsigned long long)pc_misses[w], (unsigned long long)pc_taken[w],
+            w << 1, text );
+  }
+  if( count > PROFILE_TOP ){
+    printf( "  ... %u more addresses\n", count - PROFILE_TOP );
+  }
+
+  fp = fopen( csv, "w" );
+  if( fp == NULL ){
+    printf( "cannot write profile to %s\n", csv );
+    return;
+  }
+  fprintf( fp, "start,end,executions,instructions,cache_misses,branches_taken\n" );
+  for( i=0; i<WORDS; i++ ){
+    if( bb_execs[i] ){
+      fprintf( fp, "%06o,%06o,%llu,%llu,%llu,%llu\n", i << 1, bb_last[i],
+               (unsigned long long)bb_execs[i], (unsigned long long)bb_insts[i],
+               (unsigned long long)bb_misses[i], (unsigned long long)bb_taken[i] );
+    }
+  }
+  fclose( fp );
+}
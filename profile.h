@@ -0,0 +1,13 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PROFILE_TOP 40
+
+void profile_init( void );
+void profile_inst( uint16_t pc, unsigned int inst_misses, bool taken, bool branch );
+void profile_report( const char *csv );
+
+#endif
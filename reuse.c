@@ -0,0 +1,212 @@
+/* reuse distance and working-set analysis
+ *
+ * for each access, the reuse (stack) distance is the number of distinct
+ *   cache lines touched since the previous access to the same line; a
+ *   fully associative LRU cache of C lines hits exactly the accesses
+ *   with distance < C, so the histogram predicts hit rates for every
+ *   capacity at once
+ *
+ * routines
+ *
+ *   bool reuse_init( const char *spec );
+ *   void reuse_attach( void );
+ *   void reuse_access( uint16_t address, bool fetch );
+ *   void reuse_stats( void );
+ *
+ * spec is the working-set window length in accesses; instruction
+ *   fetches and data accesses are tracked as separate streams, each
+ *   with its own histograms
+ *
+ * distances are computed with a Fenwick (binary indexed) tree over
+ *   access timestamps: the tree holds a 1 at the time of the most
+ *   recent access to every line, so the distance of an access is the
+ *   number of 1s after that line's previous timestamp - O(log n) per
+ *   access instead of walking an LRU stack
+ *
+ * timestamps run up to TIME_CAP; when they run out, the live lines are
+ *   renumbered 1..L in access order and the tree is rebuilt, which
+ *   costs O(L log L) once every TIME_CAP - L accesses
+ *
+ * histogram bucket b counts distances d with 2^(b-1) <= d < 2^b, and
+ *   bucket 0 counts d = 0; first touches are counted separately
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pdp11-sim.h"
+#include "reuse.h"
+#include "hooks.h"
+
+#define LINES ((MEMSIZE >> REUSE_LINE_SHIFT) + 1)
+#define TIME_CAP (8 * LINES)
+
+typedef struct {
+  const char *name;
+  uint32_t
+    last[LINES],        /* timestamp of the line's last access, 0 = never */
+    tree[TIME_CAP+1],   /* Fenwick tree over timestamps                    */
+    window_id[LINES];   /* last working-set window the line was seen in    */
+  uint32_t now;         /* next timestamp                                  */
+  uint64_t
+    accesses,
+    cold,                       /* first touches        */
+    distance[REUSE_BUCKETS],    /* reuse distances      */
+    wss[REUSE_BUCKETS];         /* working-set sizes    */
+  uint32_t window, window_accesses, window_lines;
+  uint64_t windows, wss_sum, wss_max, wss_min;
+} stream_t;
+
+static stream_t fetches, data;
+static uint32_t window_len;
+
+bool reuse_active = false;
+
+static void tree_add( stream_t *s, uint32_t t, int delta ){
+  for( ; t <= TIME_CAP; t += t & -t ) s->tree[t] += delta;
+}
+
+static uint32_t tree_sum( stream_t *s, uint32_t t ){
+  uint32_t sum = 0;
+  for( ; t > 0; t -= t & -t ) sum += s->tree[t];
+  return sum;
+}
+
+static unsigned int bucket( uint64_t x ){
+  unsigned int b = 0;
+  while( x ){
+    b++;
+    x >>= 1;
+  }
+  return b < REUSE_BUCKETS ? b : REUSE_BUCKETS-1;
+}
+
+static void stream_init( stream_t *s, const char *name ){
+  memset( s, 0, sizeof( *s ) );
+  s->name = name;
+  s->now = 1;
+  s->window = 1;
+  s->wss_min = UINT64_MAX;
+}
+
+bool reuse_init( const char *spec ){
+  char *end;
+  long n = strtol( spec, &end, 10 );
+  if( n <= 0 || *end != '\0' ) return false;
+  window_len = n;
+  stream_init( &fetches, "instruction" );
+  stream_init( &data, "data" );
+  reuse_active = true;
+  return true;
+}
+
+/* renumber live lines 1..L in access order and rebuild the tree */
+
+static uint32_t by_time_last[LINES];
+
+static int by_time( const void *a, const void *b ){
+  uint32_t x = by_time_last[*(const uint32_t *)a], y = by_time_last[*(const uint32_t *)b];
+  return (x > y) - (x < y);
+}
+
+static void compact( stream_t *s ){
+  static uint32_t order[LINES];
+  uint32_t i, live = 0;
+
+  for( i=0; i<LINES; i++ ){
+    if( s->last[i] ) order[live++] = i;
+  }
+  memcpy( by_time_last, s->last, sizeof( by_time_last ) );
+  qsort( order, live, sizeof( order[0] ), by_time );
+
+  memset( s->tree, 0, sizeof( s->tree ) );
+  for( i=0; i<live; i++ ){
+    s->last[order[i]] = i+1;
+    tree_add( s, i+1, 1 );
+  }
+  s->now = live+1;
+}
+
+static void end_window( stream_t *s ){
+  s->wss[bucket( s->window_lines )]++;
+  s->wss_sum += s->window_lines;
+  if( s->window_lines > s->wss_max ) s->wss_max = s->window_lines;
+  if( s->window_lines < s->wss_min ) s->wss_min = s->window_lines;
+  s->windows++;
+  s->window++;
+  s->window_accesses = 0;
+  s->window_lines = 0;
+}
+
+void reuse_access( uint16_t address, bool fetch ){
+  stream_t *s = fetch ? &fetches : &data;
+  uint32_t line = address >> REUSE_LINE_SHIFT;
+
+  if( s->now > TIME_CAP ) compact( s );
+
+  s->accesses++;
+  if( s->last[line] == 0 ){
+    s->cold++;
+  }else{
+    uint32_t d = tree_sum( s, s->now-1 ) - tree_sum( s, s->last[line] );
+    s->distance[bucket( d )]++;
+    tree_add( s, s->last[line], -1 );
+  }
+  tree_add( s, s->now, 1 );
+  s->last[line] = s->now++;
+
+  if( s->window_id[line] != s->window ){
+    s->window_id[line] = s->window;
+    s->window_lines++;
+  }
+  if( ++s->window_accesses == window_len ) end_window( s );
+}
+
+static void print_histogram( const uint64_t *h, uint64_t total ){
+  unsigned int b;
+  for( b=0; b<REUSE_BUCKETS; b++ ){
+    if( h[b] == 0 ) continue;
+    if( b == 0 ) printf( "    %15s", "0" );
+    else printf( "    %7llu - %5llu", 1ULL << (b-1), (1ULL << b) - 1 );
+    printf( " %12llu (%0.1f%%)\n", (unsigned long long)h[b], 100.0 * h[b] / total );
+  }
+}
+
+static void stream_stats( stream_t *s ){
+  uint64_t reused = s->accesses - s->cold;
+
+  printf( "  %s accesses = %llu, first touches = %llu\n", s->name,
+          (unsigned long long)s->accesses, (unsigned long long)s->cold );
+  if( reused ){
+    printf( "  %s reuse distance (distinct %d-byte lines):\n", s->name, 1 << REUSE_LINE_SHIFT );
+    print_histogram( s->distance, reused );
+  }
+  if( s->windows ){
+    printf( "  %s working set per %u accesses: min %llu, mean %0.1f, max %llu lines\n",
+            s->name, window_len, (unsigned long long)s->wss_min,
+            (double)s->wss_sum / s->windows, (unsigned long long)s->wss_max );
+    print_histogram( s->wss, s->windows );
+  }
+}
+
+static void fetch_hook( uint16_t pc, uint16_t address ){
+  reuse_access( address, true );
+}
+
+static void data_hook( uint16_t pc, uint16_t address ){
+  reuse_access( address, false );
+}
+
+/* register on the fetch, read, and write hooks */
+
+void reuse_attach( void ){
+  hook_fetch( fetch_hook );
+  hook_read( data_hook );
+  hook_write( data_hook );
+}
+
+void reuse_stats( void ){
+  printf( "locality statistics (in decimal):\n" );
+  stream_stats( &fetches );
+  stream_stats( &data );
+}
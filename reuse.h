@@ -0,0 +1,19 @@
+#ifndef REUSE_H
+#define REUSE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cache.h"
+
+#define REUSE_LINE_SHIFT LINE_SHIFT  /* same lines as the cache */
+#define REUSE_BUCKETS 18    /* log2 buckets, enough for every line */
+
+extern bool reuse_active;
+
+bool reuse_init( const char *spec );
+void reuse_attach( void );
+void reuse_access( uint16_t address, bool fetch );
+void reuse_stats( void );
+
+#endif
@@ -0,0 +1,240 @@
+/* basic-block vectors and SimPoint-style phase clustering
+ *
+ * for every fixed-size interval of guest instructions, records how many
+ *   instructions ran in each basic block (the block's BBV); at exit the
+ *   vectors are clustered with k-means and one representative interval
+ *   is chosen per cluster, weighted by the cluster's share of the run
+ *
+ * routines
+ *
+ *   bool simpoint_init( const char *spec );
+ *   void simpoint_inst( uint16_t pc, bool branch );
+ *   void simpoint_report( void );
+ *
+ * spec is "<interval>,<k>[,<file>]"; the chosen points are printed, and
+ *   also written to <file> one per line as
+ *     <interval index> <starting instruction count> <weight> <cluster>
+ *   so a detailed run can be restricted to those instruction windows
+ *
+ * blocks are the dynamic ones used by the profiler: a block starts at
+ *   the first instruction and after every branch, and is keyed by its
+ *   leader PC
+ *
+ * as in SimPoint, each interval's BBV is normalised to sum to 1 and
+ *   reduced to SIMPOINT_DIMS dimensions by a fixed random projection
+ *   before clustering, so only SIMPOINT_DIMS doubles are kept per
+ *   interval however many blocks the image has; the projection and the
+ *   k-means++ seeding use a fixed-seed generator, so a given run always
+ *   picks the same points
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+
+#include "pdp11-sim.h"
+#include "simpoint.h"
+
+#define WORDS (MEMSIZE/2)
+
+static uint32_t
+  block_insts[WORDS],   /* instructions per block this interval, by leader */
+  touched[WORDS];       /* leaders with nonzero block_insts               */
+
+static unsigned int num_touched = 0;
+static unsigned int leader = 0;
+static bool new_block = true;
+
+static int interval = 0, k = 0, interval_insts = 0;
+static const char *path = NULL;
+
+static double *vectors = NULL;        /* SIMPOINT_DIMS per interval */
+static size_t num_vectors = 0, capacity = 0;
+
+bool simpoint_active = false;
+
+/* fixed-seed generator for the projection and the k-means++ seeding */
+
+static uint32_t rng_state = 1;
+
+static double uniform( void ){
+  rng_state = rng_state * 1103515245u + 12345u;
+  return ((rng_state >> 8) & 0xFFFFFF) / (double)0x1000000;
+}
+
+/* projection weight in [-1,1) for (block, dimension), derived by hashing
+ *   so that the matrix never has to be stored */
+
+static double projection( unsigned int block, int dim ){
+  uint32_t h = block * 2654435761u ^ (dim + 1) * 2246822519u;
+  h ^= h >> 15;
+  h *= 2654435761u;
+  h ^= h >> 13;
+  return (h & 0xFFFF) / 32768.0 - 1.0;
+}
+
+bool simpoint_init( const char *spec ){
+  char *end;
+  interval = strtol( spec, &end, 10 );
+  if( interval <= 0 || *end != ',' ) return false;
+  k = strtol( end+1, &end, 10 );
+  if( k <= 0 ) return false;
+  if( *end == ',' && end[1] != '\0' ) path = end+1;
+  else if( *end != '\0' ) return false;
+
+  memset( block_insts, 0, sizeof( block_insts ) );
+  num_touched = 0;
+  interval_insts = 0;
+  new_block = true;
+  capacity = 1024;
+  vectors = malloc( capacity * SIMPOINT_DIMS * sizeof( double ) );
+  num_vectors = 0;
+  simpoint_active = true;
+  return true;
+}
+
+/* project and store the finished interval's BBV, then clear it */
+
+static void close_interval( void ){
+  double *v;
+  unsigned int i;
+  int d;
+
+  if( num_vectors == capacity ){
+    capacity *= 2;
+    vectors = realloc( vectors, capacity * SIMPOINT_DIMS * sizeof( double ) );
+  }
+  v = &vectors[num_vectors++ * SIMPOINT_DIMS];
+  for( d=0; d<SIMPOINT_DIMS; d++ ) v[d] = 0.0;
+
+  for( i=0; i<num_touched; i++ ){
+    unsigned int b = touched[i];
+    double share = (double)block_insts[b] / interval_insts;
+    for( d=0; d<SIMPOINT_DIMS; d++ ) v[d] += share * projection( b, d );
+    block_insts[b] = 0;
+  }
+  num_touched = 0;
+  interval_insts = 0;
+}
+
+void simpoint_inst( uint16_t pc, bool branch ){
+  if( new_block ) leader = pc >> 1;
+  if( block_insts[leader]++ == 0 ) touched[num_touched++] = leader;
+  new_block = branch;
+
+  if( ++interval_insts == interval ) close_interval();
+}
+
+static double distance( const double *a, const double *b ){
+  double sum = 0.0;
+  int d;
+  for( d=0; d<SIMPOINT_DIMS; d++ ) sum += (a[d]-b[d]) * (a[d]-b[d]);
+  return sum;
+}
+
+void simpoint_report( void ){
+  double *centers, *best_dist;
+  int *assign, *size, *rep;
+  size_t i, n;
+  int c, d, it, clusters;
+  FILE *fp = NULL;
+
+  /* a partial last interval is only kept if it is the whole run */
+  if( interval_insts > 0 && num_vectors == 0 ) close_interval();
+  n = num_vectors;
+  if( n == 0 ) return;
+  clusters = (size_t)k < n ? k : (int)n;
+
+  centers = malloc( clusters * SIMPOINT_DIMS * sizeof( double ) );
+  best_dist = malloc( n * sizeof( double ) );
+  assign = malloc( n * sizeof( int ) );
+  size = calloc( clusters, sizeof( int ) );
+  rep = malloc( clusters * sizeof( int ) );
+
+  /* k-means++ seeding */
+  rng_state = 1;
+  memcpy( centers, &vectors[(size_t)(uniform() * n) * SIMPOINT_DIMS],
+          SIMPOINT_DIMS * sizeof( double ) );
+  for( i=0; i<n; i++ ) best_dist[i] = distance( &vectors[i*SIMPOINT_DIMS], centers );
+  for( c=1; c<clusters; c++ ){
+    double total = 0.0, pick;
+    for( i=0; i<n; i++ ) total += best_dist[i];
+    pick = uniform() * total;
+    for( i=0; i<n-1 && pick >= best_dist[i]; i++ ) pick -= best_dist[i];
+    memcpy( &centers[c*SIMPOINT_DIMS], &vectors[i*SIMPOINT_DIMS], SIMPOINT_DIMS * sizeof( double ) );
+    for( i=0; i<n; i++ ){
+      double dist = distance( &vectors[i*SIMPOINT_DIMS], &centers[c*SIMPOINT_DIMS] );
+      if( dist < best_dist[i] ) best_dist[i] = dist;
+    }
+  }
+
+  /* Lloyd iterations until no interval changes cluster */
+  for( i=0; i<n; i++ ) assign[i] = -1;
+  for( it=0; it<SIMPOINT_ITERS; it++ ){
+    bool changed = false;
+    for( i=0; i<n; i++ ){
+      double best = DBL_MAX;
+      int choice = 0;
+      for( c=0; c<clusters; c++ ){
+        double dist = distance( &vectors[i*SIMPOINT_DIMS], &centers[c*SIMPOINT_DIMS] );
+        if( dist < best ){
+          best = dist;
+          choice = c;
+        }
+      }
+      if( assign[i] != choice ) changed = true;
+      assign[i] = choice;
+    }
+    if( !changed ) break;
+
+    memset( centers, 0, clusters * SIMPOINT_DIMS * sizeof( double ) );
+    memset( size, 0, clusters * sizeof( int ) );
+    for( i=0; i<n; i++ ){
+      size[assign[i]]++;
+      for( d=0; d<SIMPOINT_DIMS; d++ ) centers[assign[i]*SIMPOINT_DIMS+d] += vectors[i*SIMPOINT_DIMS+d];
+    }
+    for( c=0; c<clusters; c++ ){
+      for( d=0; d<SIMPOINT_DIMS && size[c]; d++ ) centers[c*SIMPOINT_DIMS+d] /= size[c];
+    }
+  }
+
+  /* representative = interval closest to its cluster's center */
+  memset( size, 0, clusters * sizeof( int ) );
+  for( c=0; c<clusters; c++ ){
+    rep[c] = -1;
+    best_dist[c] = DBL_MAX;
+  }
+  for( i=0; i<n; i++ ){
+    double dist = distance( &vectors[i*SIMPOINT_DIMS], &centers[assign[i]*SIMPOINT_DIMS] );
+    c = assign[i];
+    size[c]++;
+    if( dist < best_dist[c] ){
+      best_dist[c] = dist;
+      rep[c] = i;
+    }
+  }
+
+  if( path != NULL ){
+    fp = fopen( path, "w" );
+    if( fp == NULL ) printf( "cannot write simulation points to %s\n", path );
+  }
+
+  printf( "simulation points (in decimal, %zu intervals of %d instructions):\n", n, interval );
+  printf( "  cluster  interval   start inst   weight\n" );
+  for( c=0; c<clusters; c++ ){
+    if( size[c] == 0 ) continue;
+    printf( "  %7d %9d %12llu   %0.4f\n", c, rep[c],
+            (unsigned long long)rep[c] * interval, (double)size[c] / n );
+    if( fp != NULL ){
+      fprintf( fp, "%d %llu %0.6f %d\n", rep[c],
+               (unsigned long long)rep[c] * interval, (double)size[c] / n, c );
+    }
+  }
+  if( fp != NULL ) fclose( fp );
+
+  free( centers );
+  free( best_dist );
+  free( assign );
+  free( size );
+  free( rep );
+}
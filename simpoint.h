@@ -0,0 +1,16 @@
+#ifndef SIMPOINT_H
+#define SIMPOINT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SIMPOINT_DIMS 15
+#define SIMPOINT_ITERS 100
+
+extern bool simpoint_active;
+
+bool simpoint_init( const char *spec );
+void simpoint_inst( uint16_t pc, bool branch );
+void simpoint_report( void );
+
+#endif
@@ -0,0 +1,142 @@
+/* cycle-level timing model
+ *
+ * assigns each instruction a cycle count built from PDP-11/70 style
+ *   timing tables - a base execute time per opcode plus source and
+ *   destination address calculation times per addressing mode - and
+ *   adds the latency of every cache hit, miss, and write-back the
+ *   instruction caused in the cache model
+ *
+ * routines
+ *
+ *   void timing_init( double mhz );
+ *   bool timing_latencies( const char *spec );
+ *   void timing_inst( int op, uint16_t instruction, bool taken,
+ *                     unsigned int inst_hits, unsigned int inst_misses,
+ *                     unsigned int inst_write_backs );
+ *   void timing_stats( int insts );
+ *
+ * timing_inst() is called by the instrumented main loop after each
+ *   instruction; the running total is kept in cycles
+ *
+ * table values are in processor cycles and follow the shape of the
+ *   PDP-11/70 instruction timing tables (150 ns microcycles, with
+ *   the memory reference time of each mode split out into the cache
+ *   latencies below); they are meant for comparing configurations,
+ *   not for cycle-exact reproduction of a real machine
+ *
+ * stalls for a full write buffer (wbuf.c) are charged as they occur;
+ *   with the DRAM model (dram.c) on, the cycles it reports replace the
+ *   fixed miss and write-back latencies
+ *
+ * cache latencies default to 1 cycle per hit, 8 cycles per miss, and
+ *   8 cycles per write-back, and are set with timing_latencies() from
+ *   a "hit,miss,writeback" string
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pdp11-sim.h"
+#include "timing.h"
+#include "wbuf.h"
+#include "dram.h"
+
+enum { T_BASE, T_SRC, T_DST, T_BRANCH, T_HIT, T_MISS, T_WB, T_STALL, T_DRAM, T_CATS };
+
+static const char *category_names[T_CATS] = {
+  "execute", "source operand", "destination operand", "branch taken",
+  "cache hits", "cache misses", "cache write backs", "write buffer stalls", "dram accesses"
+};
+
+static const unsigned int
+  base_cycles[NUM_OPS]  /* execute time by opcode, see OP_* order */
+                        /* mov cmp add sub sob br bne beq asr asl halt wait rti inv */
+                 =      {  2,  2,  2,  2,  3, 2,  2,  2,  3,  3,  12,   2,  6,   0 },
+
+  src_cycles[8]  /* source address time by mode */
+                 =      { 0, 1, 1, 3, 2, 4, 3, 5 },
+
+  dst_cycles[8]  /* destination address time by mode */
+                 =      { 0, 1, 1, 3, 2, 4, 3, 5 },
+
+  taken_cycles = 1;  /* extra time to redirect fetch on a taken branch */
+
+static unsigned int
+  hit_latency = 1,
+  miss_latency = 8,
+  write_back_latency = 8;
+
+static uint64_t by_category[T_CATS];
+static uint64_t last_stall_cycles = 0;  /* wbuf_stall_cycles already charged */
+static uint64_t last_dram_cycles = 0;   /* dram_cycles already charged */
+static double clock_mhz;
+
+bool timing_active = false;
+uint64_t cycles = 0;
+
+void timing_init( double mhz ){
+  memset( by_category, 0, sizeof( by_category ) );
+  clock_mhz = mhz;
+  cycles = 0;
+  timing_active = true;
+}
+
+bool timing_latencies( const char *spec ){
+  unsigned int hit, miss, wb;
+  char extra;
+  if( sscanf( spec, "%u,%u,%u%c", &hit, &miss, &wb, &extra ) != 3 ) return false;
+  hit_latency = hit;
+  miss_latency = miss;
+  write_back_latency = wb;
+  return true;
+}
+
+void timing_inst( int op, uint16_t instruction, bool taken, unsigned int inst_hits,
+                  unsigned int inst_misses, unsigned int inst_write_backs ){
+  uint64_t t[T_CATS] = { 0 };
+  int i;
+
+  t[T_BASE] = base_cycles[op];
+  switch( op ){
+    case OP_MOV: case OP_CMP: case OP_ADD: case OP_SUB:
+      t[T_SRC] = src_cycles[(instruction & 0x0E00) >> 9];
+      t[T_DST] = dst_cycles[(instruction & 0x0038) >> 3];
+      break;
+    case OP_ASR: case OP_ASL:
+      t[T_DST] = dst_cycles[(instruction & 0x0038) >> 3];
+      break;
+  }
+  if( taken ) t[T_BRANCH] = taken_cycles;
+  t[T_HIT] = (uint64_t)inst_hits * hit_latency;
+  if( dram_active ){
+    t[T_DRAM] = dram_cycles - last_dram_cycles;
+    last_dram_cycles = dram_cycles;
+  }else{
+    t[T_MISS] = (uint64_t)inst_misses * miss_latency;
+    t[T_WB] = (uint64_t)inst_write_backs * write_back_latency;
+  }
+  t[T_STALL] = wbuf_stall_cycles - last_stall_cycles;
+  last_stall_cycles = wbuf_stall_cycles;
+
+  for( i=0; i<T_CATS; i++ ){
+    by_category[i] += t[i];
+    cycles += t[i];
+  }
+}
+
+void timing_stats( int insts ){
+  int i;
+  printf( "timing statistics (in decimal):\n" );
+  printf( "  total cycles      = %llu\n", (unsigned long long)cycles );
+  printf( "  cycles per inst   = %0.3f\n", insts ? (double)cycles / insts : 0.0 );
+  printf( "  guest time        = %0.3f us at %0.2f MHz\n", cycles / clock_mhz, clock_mhz );
+  if( dram_active ) printf( "  latency hit = %u cycles, misses and write backs from dram\n",
+                           hit_latency );
+  else printf( "  latency hit/miss/wb = %u/%u/%u cycles\n",
+               hit_latency, miss_latency, write_back_latency );
+  for( i=0; i<T_CATS; i++ ){
+    printf( "  %-20s %12llu (%0.1f%%)\n", category_names[i],
+            (unsigned long long)by_category[i],
+            cycles ? 100.0 * by_category[i] / cycles : 0.0 );
+  }
+}
@@ -0,0 +1,16 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+extern bool timing_active;
+extern uint64_t cycles;
+
+void timing_init( double mhz );
+bool timing_latencies( const char *spec );
+void timing_inst( int op, uint16_t instruction, bool taken, unsigned int inst_hits,
+                  unsigned int inst_misses, unsigned int inst_write_backs );
+void timing_stats( int insts );
+
+#endif
@@ -0,0 +1,94 @@
+/* Unibus I/O page dispatch
+ *
+ * the top 8 KiB of the 16-bit address space (160000-177777) holds
+ *   device registers instead of memory; bus_read() and bus_write() in
+ *   unibus.h send references there to the routines below, and
+ *   everything else straight to memory[]
+ *
+ * routines
+ *
+ *   bool unibus_register( uint16_t base, unsigned int words,
+ *                         io_read_t rd, io_write_t wr );
+ *   uint16_t unibus_read( uint16_t address );
+ *   void unibus_write( uint16_t address, uint16_t value );
+ *   bool unibus_peek( uint16_t address, uint16_t *value );
+ *   bool bus_peek( uint16_t address, uint16_t *value );
+ *
+ * unibus_register() claims words registers starting at base for one
+ *   device; rd and wr are called with the full register address, and
+ *   either may be NULL for a write-only or read-only register (reads
+ *   then return 0, writes are ignored); it returns false if the range
+ *   is outside the I/O page or overlaps a registered device
+ *
+ * the dispatch table has one entry per I/O page word, so a device
+ *   reference costs one table lookup; a reference to a register no
+ *   device claimed is a bus timeout, which stops the simulator since
+ *   there are no traps yet
+ *
+ * the peek routines are for the debugger and disassembler: they give
+ *   the word a read would see, or false where it would time out or
+ *   abort, and change nothing; a device read routine leaves out its side
+ *   effects while bus_peeking is set
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "unibus.h"
+
+bool bus_peeking = false;  /* a read routine is being called by a peek */
+
+static io_read_t read_table[IOPAGE_WORDS];
+static io_write_t write_table[IOPAGE_WORDS];
+static bool claimed[IOPAGE_WORDS];
+
+bool unibus_register( uint16_t base, unsigned int words, io_read_t rd, io_write_t wr ){
+  unsigned int first, i;
+
+  if( base < IOPAGE || (base & 1) ) return false;
+  first = (base - IOPAGE) >> 1;
+  if( first + words > IOPAGE_WORDS ) return false;
+  for( i=first; i<first+words; i++ ){
+    if( claimed[i] ) return false;
+  }
+  for( i=first; i<first+words; i++ ){
+    claimed[i] = true;
+    read_table[i] = rd;
+    write_table[i] = wr;
+  }
+  return true;
+}
+
+static void bus_timeout( uint16_t address ){
+  printf( "Bus timeout at %06o (PC %06o)\n", address, inst_pc );
+  exit( 1 );
+}
+
+uint16_t unibus_read( uint16_t address ){
+  unsigned int i = (address - IOPAGE) >> 1;
+  if( !claimed[i] ) bus_timeout( address );
+  if( read_table[i] == NULL ) return 0;
+  return read_table[i]( address & ~1 );
+}
+
+void unibus_write( uint16_t address, uint16_t value ){
+  unsigned int i = (address - IOPAGE) >> 1;
+  if( !claimed[i] ) bus_timeout( address );
+  if( write_table[i] != NULL ) write_table[i]( address & ~1, value );
+}
+
+bool unibus_peek( uint16_t address, uint16_t *value ){
+  unsigned int i = (address - IOPAGE) >> 1;
+  if( !claimed[i] ) return false;
+  bus_peeking = true;
+  *value = read_table[i] == NULL ? 0 : read_table[i]( address & ~1 );
+  bus_peeking = false;
+  return true;
+}
+
+bool bus_peek( uint16_t address, uint16_t *value ){
+  if( mmu_on ) return mmu_peek( address, value );
+  if( address >= IOPAGE ) return unibus_peek( address, value );
+  *value = memory[address];
+  return true;
+}
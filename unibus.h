@@ -0,0 +1,45 @@
+#ifndef UNIBUS_H
+#define UNIBUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "pdp11-sim.h"
+#include "mmu.h"
+
+#define IOPAGE 0160000                      /* first I/O page address */
+#define IOPAGE_WORDS ((0200000 - IOPAGE) >> 1)
+#define PSW_ADDR 0177776                    /* processor status word */
+
+typedef uint16_t (*io_read_t)( uint16_t address );
+typedef void (*io_write_t)( uint16_t address, uint16_t value );
+
+bool unibus_register( uint16_t base, unsigned int words, io_read_t rd, io_write_t wr );
+uint16_t unibus_read( uint16_t address );
+void unibus_write( uint16_t address, uint16_t value );
+bool unibus_peek( uint16_t address, uint16_t *value );
+bool bus_peek( uint16_t address, uint16_t *value );
+
+extern bool bus_peeking;
+
+/* every guest memory reference goes through these; with the MMU off,
+ *   RAM is everything below IOPAGE, so the fast path is a single
+ *   compare; with it on, the reference is translated (mmu.h); a store
+ *   to RAM marks its page in dirty_map for the checkpoints */
+
+static inline uint16_t bus_read( uint16_t address ){
+  if( mmu_on ) return mmu_read( address );
+  if( address >= IOPAGE ) return unibus_read( address );
+  return memory[address];
+}
+
+static inline void bus_write( uint16_t address, uint16_t value ){
+  if( mmu_on ) mmu_write( address, value );
+  else if( address >= IOPAGE ) unibus_write( address, value );
+  else{
+    memory[address] = value;
+    mark_dirty( address );
+  }
+}
+
+#endif
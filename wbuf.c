@@ -0,0 +1,150 @@
+/* write buffer between the cache and memory
+ *
+ * every write that leaves the cache - write-through stores, stores that
+ *   miss without write-allocate, and write-backs of dirty lines - goes
+ *   through this model on its way to memory
+ *
+ * routines
+ *
+ *   bool wbuf_config( const char *spec );
+ *   void wbuf_tick( void );
+ *   void wbuf_write( uint32_t line, unsigned int mask );
+ *   void wbuf_stats( void );
+ *
+ * spec is "<depth>,<coalesce|nocoalesce>,<drain>": the buffer holds up
+ *   to depth line-sized entries (at most WBUF_MAX), and retires the
+ *   oldest entry to memory every drain cycles; with coalescing, a write
+ *   to a line already waiting in the buffer merges into that entry
+ *
+ * time advances one cycle per cache access (wbuf_tick() is called by
+ *   cache_access()); a write that finds the buffer full stalls until
+ *   the oldest entry retires, and the wait is added to
+ *   wbuf_stall_cycles, which the timing model charges
+ *
+ * mask has one bit per byte of the 4-byte line being written; memory
+ *   write traffic counts the bytes that actually reach memory, so
+ *   coalesced writes to the same bytes are only counted once
+ *
+ * with depth 0 (the default) there is no buffer and writes go straight
+ *   to memory; with the DRAM model on, the writer then waits for the
+ *   DRAM write, while a buffered write is sent to the DRAM when it
+ *   retires, without stalling the processor
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wbuf.h"
+#include "dram.h"
+
+typedef struct {
+  uint32_t line;
+  unsigned int mask;
+} wbuf_entry_t;
+
+static wbuf_entry_t entries[WBUF_MAX];
+static unsigned int head = 0, count = 0;
+
+static unsigned int
+  depth = 0,
+  drain = 1;
+
+static bool coalesce = false;
+
+bool wbuf_active = false;  /* configured with wbuf_config() */
+
+static uint64_t
+  now = 0,          /* cycles, one per cache access */
+  next_retire = 0,  /* when the oldest entry leaves */
+  writes = 0,       /* writes into the buffer       */
+  coalesced = 0,    /* writes merged into an entry  */
+  full_stalls = 0;  /* writes that found it full    */
+
+uint64_t
+  memory_write_bytes = 0,
+  wbuf_stall_cycles = 0;
+
+static unsigned int bytes( unsigned int mask ){
+  unsigned int n = 0;
+  for( ; mask; mask >>= 1 ) n += mask & 1;
+  return n;
+}
+
+bool wbuf_config( const char *spec ){
+  char mode[16];
+  int d, r;
+  if( sscanf( spec, "%d,%15[a-z],%d", &d, mode, &r ) != 3 ) return false;
+  if( d < 0 || d > WBUF_MAX || r < 1 ) return false;
+  if( strcmp( mode, "coalesce" ) == 0 ) coalesce = true;
+  else if( strcmp( mode, "nocoalesce" ) == 0 ) coalesce = false;
+  else return false;
+  depth = d;
+  drain = r;
+  wbuf_active = true;
+  return true;
+}
+
+static void retire( void ){
+  memory_write_bytes += bytes( entries[head].mask );
+  if( dram_active ) dram_access( entries[head].line, true );
+  head = (head + 1) % WBUF_MAX;
+  count--;
+  next_retire = now + drain;
+}
+
+void wbuf_tick( void ){
+  now++;
+  if( count && now >= next_retire ) retire();
+}
+
+void wbuf_write( uint32_t line, unsigned int mask ){
+  unsigned int i;
+
+  if( depth == 0 ){
+    memory_write_bytes += bytes( mask );
+    if( dram_active ) dram_cycles += dram_access( line, true );
+    return;
+  }
+
+  writes++;
+  if( coalesce ){
+    for( i=0; i<count; i++ ){
+      wbuf_entry_t *e = &entries[(head + i) % WBUF_MAX];
+      if( e->line == line ){
+        e->mask |= mask;
+        coalesced++;
+        return;
+      }
+    }
+  }
+
+  if( count == depth ){
+    full_stalls++;
+    wbuf_stall_cycles += next_retire - now;
+    now = next_retire;
+    retire();
+  }
+  if( count == 0 ) next_retire = now + drain;
+
+  entries[(head + count) % WBUF_MAX].line = line;
+  entries[(head + count) % WBUF_MAX].mask = mask;
+  count++;
+}
+
+void wbuf_stats( void ){
+  uint64_t pending = 0;
+  unsigned int i;
+
+  /* entries still waiting at halt drain eventually; count their bytes */
+  for( i=0; i<count; i++ ) pending += bytes( entries[(head + i) % WBUF_MAX].mask );
+
+  printf( "  memory write bytes = %llu\n", (unsigned long long)(memory_write_bytes + pending) );
+  if( depth == 0 ) return;
+  printf( "  write buffer: %u entries, %scoalescing, drain every %u cycles\n",
+          depth, coalesce ? "" : "no ", drain );
+  printf( "    writes          = %llu\n", (unsigned long long)writes );
+  printf( "    coalesced       = %llu\n", (unsigned long long)coalesced );
+  printf( "    full stalls     = %llu\n", (unsigned long long)full_stalls );
+  printf( "    stall cycles    = %llu\n", (unsigned long long)wbuf_stall_cycles );
+}
@@ -0,0 +1,17 @@
+#ifndef WBUF_H
+#define WBUF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define WBUF_MAX 64
+
+extern bool wbuf_active;
+extern uint64_t memory_write_bytes, wbuf_stall_cycles;
+
+bool wbuf_config( const char *spec );
+void wbuf_tick( void );
+void wbuf_write( uint32_t line, unsigned int mask );
+void wbuf_stats( void );
+
+#endif